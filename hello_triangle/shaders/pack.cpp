@@ -0,0 +1,82 @@
+// Packs compiled shader variants into the archive read by ShaderArchive.
+// usage: shader_pack <out> <key> <spv> [<key> <spv> ...]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "shader_archive.h"
+
+struct Variant {
+  std::string key;
+  std::vector<char> code;
+};
+
+static void append(std::vector<char>& out, const void* data, size_t size) {
+  auto bytes = static_cast<const char*>(data);
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc % 2 != 0) {
+    std::cerr << "usage: " << argv[0] << " <out> <key> <spv> [<key> <spv> ...]\n";
+    return 1;
+  }
+
+  std::vector<Variant> variants;
+  for (int i = 2; i < argc; i += 2) {
+    std::ifstream in(argv[i + 1], std::ios::binary);
+    if (!in) {
+      std::cerr << "cannot read " << argv[i + 1] << "\n";
+      return 1;
+    }
+    std::vector<char> code{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    if (code.size() % 4 != 0) {
+      std::cerr << argv[i + 1] << " is not SPIR-V\n";
+      return 1;
+    }
+    variants.push_back({argv[i], std::move(code)});
+  }
+  std::sort(variants.begin(), variants.end(), [](const Variant& a, const Variant& b) {
+    return a.key < b.key;
+  });
+  for (size_t i = 1; i < variants.size(); ++i) {
+    if (variants[i].key == variants[i - 1].key) {
+      std::cerr << "duplicate shader variant " << variants[i].key << "\n";
+      return 1;
+    }
+  }
+
+  uint32_t count = variants.size();
+  std::vector<shader_archive::Entry> entries(count);
+  size_t offset = 2 * sizeof(uint32_t) + count * sizeof(shader_archive::Entry);
+  std::vector<char> payload;
+  for (uint32_t i = 0; i < count; ++i) {
+    entries[i].key_offset = offset + payload.size();
+    entries[i].key_size = variants[i].key.size();
+    append(payload, variants[i].key.data(), variants[i].key.size());
+    payload.resize((offset + payload.size() + 3) / 4 * 4 - offset);
+    entries[i].code_offset = offset + payload.size();
+    entries[i].code_size = variants[i].code.size();
+    append(payload, variants[i].code.data(), variants[i].code.size());
+  }
+
+  std::vector<char> out;
+  append(out, &shader_archive::MAGIC, sizeof(uint32_t));
+  append(out, &count, sizeof(count));
+  append(out, entries.data(), entries.size() * sizeof(shader_archive::Entry));
+  append(out, payload.data(), payload.size());
+
+  std::ofstream file(argv[1], std::ios::binary);
+  file.write(out.data(), out.size());
+  if (!file) {
+    std::cerr << "cannot write " << argv[1] << "\n";
+    return 1;
+  }
+  return 0;
+}
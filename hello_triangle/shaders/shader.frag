@@ -1,8 +1,47 @@
 #version 450
 
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+
+// see GpuMaterial
+struct Material {
+  vec4 tint;
+  uint texture;
+};
+
+// every material and texture, bound once; the draw picks its material
+layout(std430, set = 1, binding = 0) readonly buffer Materials {
+  Material materials[];
+};
+layout(set = 1, binding = 1) uniform sampler2D textures[];
+
+layout(push_constant) uniform DrawPushConstants {
+  float opacity;
+  uint material;
+} c;
+#endif
+
+// set for the overdraw pipeline, which adds up the output: each layer
+// brightens the pixel by 1/8, so white means 8 or more fragments
+layout(constant_id = 0) const bool OVERDRAW = false;
+
 layout(location = 0) out vec4 outColor;
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in float fragOpacity;
+layout(location = 2) in vec2 fragUV;
 
 void main() {
-  outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+  if (OVERDRAW) {
+    outColor = vec4(vec3(0.125), 1.0);
+  }
+  else {
+    vec3 color = fragColor;
+#ifdef BINDLESS
+    // the material comes from a push constant, so the index is uniform
+    // across the draw and needs no nonuniformEXT
+    Material m = materials[c.material];
+    color *= m.tint.rgb * texture(textures[m.texture], fragUV).rgb;
+#endif
+    outColor = vec4(color, fragOpacity);
+  }
+}
@@ -1,17 +1,39 @@
 #version 450
 
-layout(push_constant) uniform VertPushConstants {
-  mat4 model;
-  mat4 view;
-  mat4 proj;
+#ifdef MULTIVIEW
+#extension GL_EXT_multiview : require
+#define VIEW_INDEX gl_ViewIndex
+#else
+#define VIEW_INDEX 0
+#endif
+
+// per frame cameras, one per layer of the multiview render pass; see
+// ViewUniforms
+layout(set = 0, binding = 1) uniform Views {
+  mat4 view_projs[4];
+} v;
+
+layout(push_constant) uniform DrawPushConstants {
+  float opacity;
+  uint material;
 } c;
 
+// indexed by firstInstance
+layout(std430, set = 0, binding = 0) readonly buffer Models {
+  mat4 models[];
+};
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out float fragOpacity;
+// planar mapping of the unit quad's xy
+layout(location = 2) out vec2 fragUV;
 
 void main() {
-  gl_Position = c.proj * c.view * c.model * vec4(inPosition, 1.0);
+  gl_Position = v.view_projs[VIEW_INDEX] * models[gl_InstanceIndex] * vec4(inPosition, 1.0);
   fragColor = inColor;
+  fragOpacity = c.opacity;
+  fragUV = inPosition.xy + 0.5;
 }
@@ -0,0 +1,70 @@
+#include "alloc_counter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> g_allocs = 0;
+
+void* allocate(size_t size) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0) {
+    size = 1;
+  }
+  while (true) {
+    if (void* ptr = std::malloc(size)) {
+      return ptr;
+    }
+    auto handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void* allocateAligned(size_t size, std::align_val_t align) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  auto alignment = static_cast<size_t>(align);
+  // aligned_alloc wants a multiple of the alignment
+  size = (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment;
+  while (true) {
+    if (void* ptr = std::aligned_alloc(alignment, size)) {
+      return ptr;
+    }
+    auto handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+} // namespace
+
+uint64_t alloc_counter::count() {
+  return g_allocs.load(std::memory_order_relaxed);
+}
+
+// the array and nothrow forms default to calling these
+void* operator new(size_t size) {
+  return allocate(size);
+}
+void* operator new(size_t size, std::align_val_t align) {
+  return allocateAligned(size, align);
+}
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
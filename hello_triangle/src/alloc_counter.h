@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts calls to the global operator new, which every std container,
+// string and std::function allocation goes through. alloc_counter.cpp
+// replaces the global allocation functions, so it must be linked into any
+// executable that uses this.
+namespace alloc_counter {
+
+// heap allocations since process start, across all threads
+uint64_t count();
+
+} // namespace alloc_counter
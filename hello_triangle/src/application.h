@@ -0,0 +1,4036 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vulkan/vulkan.hpp>
+
+// clip depth to [0,1] range
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/string_cast.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "capture.h"
+#include "component_store.h"
+#include "frame_allocator.h"
+#include "frame_writer.h"
+#include "render_graph.h"
+#include "render_queue.h"
+#include "render_scale.h"
+#include "run_report.h"
+#include "job_system.h"
+#include "options.h"
+#include "scene_graph.h"
+#include "shader_archive.h"
+#include "spsc_queue.h"
+#include "stream_cache.h"
+#include "vk_util.h"
+
+const std::vector<const char*> g_validation_layers = {
+  "VK_LAYER_KHRONOS_validation",
+};
+#ifndef NDEBUG
+constexpr bool ENABLE_VALIDATION_LAYERS = true;
+#else
+constexpr bool ENABLE_VALIDATION_LAYERS = false;
+#endif
+
+constexpr uint64_t SECOND_NS = 1000000000;
+constexpr uint64_t TIMEOUT = 10*SECOND_NS;
+
+constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+// frames that can be waiting on the GPU or the frame writer at once
+constexpr uint32_t READBACK_SLOTS = MAX_FRAMES_IN_FLIGHT + 2;
+constexpr uint32_t NO_SLOT = ~0u;
+// cameras per multiview pass; every device supporting multiview has 6
+constexpr uint32_t MAX_VIEWS = 4;
+// slots of the bindless tables, see createVkMaterials
+constexpr uint32_t MAX_TEXTURES = 1024;
+constexpr uint32_t MAX_MATERIALS = 256;
+// when the demo adds a material mid-run, exercising streaming
+constexpr uint64_t LATE_MATERIAL_FRAME = 120;
+// transient upload space per frame in flight, see FrameAllocator
+constexpr uint32_t FRAME_ARENA_SIZE = 64 * 1024;
+// lowest fraction of the output resolution --frame-budget renders at
+constexpr float MIN_RENDER_SCALE = 0.5f;
+// frames for per-frame containers to grow to their steady-state capacity
+constexpr uint64_t ALLOC_WARMUP_FRAMES = 8;
+// geometries whose staged uploads are waited on together
+constexpr size_t UPLOAD_BATCH = 64;
+// device allocations besides geometry streams: targets, tables, arenas and
+// one batch of staging buffers
+constexpr uint64_t OTHER_ALLOCATIONS = 512;
+
+// every shader variant, see ShaderArchive
+extern const uint8_t _binary_shaders_pak_start[];
+extern const uint8_t _binary_shaders_pak_end[];
+
+constexpr vk::Format DEPTH_FORMAT = vk::Format::eD32Sfloat;
+// texels are sRGB encoded, like image files
+constexpr vk::Format TEXTURE_FORMAT = vk::Format::eR8G8B8A8Srgb;
+
+// memory for buffers written in place by the CPU, skipping staging
+constexpr vk::MemoryPropertyFlags DIRECT_UPLOAD_FLAGS = vk::MemoryPropertyFlagBits::eDeviceLocal
+    | vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+// pipelines, in draw order
+enum PipelineId : uint32_t {
+  PIPELINE_OPAQUE = 0,
+  PIPELINE_TRANSPARENT,
+  // debug view replacing both of the above, never in a draw key
+  PIPELINE_OVERDRAW,
+  PIPELINE_COUNT,
+};
+// drawn with instead of a pipeline that is still compiling: none, skip the draw
+constexpr uint32_t NO_PIPELINE = PIPELINE_COUNT;
+
+enum class BlendMode : uint32_t {
+  NONE,
+  // over the scene by the fragment's alpha
+  ALPHA,
+  // summed, for counting fragments
+  ADD,
+};
+
+// What sets one graphics pipeline apart from the others, see pipelineDescs
+struct PipelineDesc {
+  PipelineId id;
+  // shader variant keys, see shaderVariant
+  std::string vert_key;
+  std::string frag_key;
+  // specializes OVERDRAW in shader.frag
+  bool overdraw = false;
+  BlendMode blend = BlendMode::NONE;
+  bool depth_test = true;
+  bool depth_write = true;
+  vk::RenderPass render_pass;
+  // compiled before createVkGraphicsPipeline returns; the others compile on
+  // the job system and draw with fallback, itself compiled immediately,
+  // until they are ready
+  bool immediate = false;
+  uint32_t fallback = NO_PIPELINE;
+};
+
+// counters collected around the scene pass with --stats, in bit order
+constexpr vk::QueryPipelineStatisticFlags PIPELINE_STATS =
+    vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives
+    | vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations
+    | vk::QueryPipelineStatisticFlagBits::eClippingInvocations
+    | vk::QueryPipelineStatisticFlagBits::eClippingPrimitives
+    | vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+
+struct PipelineStats {
+  uint64_t ia_primitives;
+  uint64_t vs_invocations;
+  uint64_t clip_invocations;
+  uint64_t clip_primitives;
+  uint64_t fs_invocations;
+};
+
+// invocations per workgroup of transforms.comp
+constexpr uint32_t TRANSFORM_GROUP_SIZE = 64;
+
+constexpr float CAMERA_NEAR = 0.1f;
+constexpr float CAMERA_FAR = 10.0f;
+
+template<typename T>
+vk::IndexType getIndexType();
+template<>
+inline vk::IndexType getIndexType<uint16_t>() {
+  return vk::IndexType::eUint16;
+}
+template<>
+inline vk::IndexType getIndexType<uint32_t>() {
+  return vk::IndexType::eUint32;
+}
+
+template<typename T>
+vk::Format getFormat();
+template<>
+inline vk::Format getFormat<glm::vec2>() {
+  return vk::Format::eR32G32Sfloat;
+}
+template<>
+inline vk::Format getFormat<glm::vec3>() {
+  return vk::Format::eR32G32B32Sfloat;
+}
+template<>
+inline vk::Format getFormat<glm::vec4>() {
+  return vk::Format::eR32G32B32A32Sfloat;
+}
+
+const std::vector<const char*> g_device_extensions = {
+  VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+};
+
+template<typename T>
+inline size_t sizeof_vec(const std::vector<T>& v) {
+  return sizeof(T) * v.size();
+}
+
+
+// bounding sphere, in the space of the vertices it bounds
+struct Bounds {
+  glm::vec3 center;
+  float radius;
+};
+
+// CPU copy of a geometry's vertex streams, only read when uploading
+struct GeometryData {
+  std::vector<glm::vec3> xs;
+  std::vector<glm::vec3> colors;
+  std::vector<uint32_t> inds;
+
+  Bounds bounds() const {
+    glm::vec3 lo = xs.empty() ? glm::vec3() : xs[0];
+    glm::vec3 hi = lo;
+    for (const auto& x : xs) {
+      lo = glm::min(lo, x);
+      hi = glm::max(hi, x);
+    }
+    Bounds bounds = {(lo + hi) * 0.5f, 0.0f};
+    for (const auto& x : xs) {
+      bounds.radius = std::max(bounds.radius, glm::length(x - bounds.center));
+    }
+    return bounds;
+  }
+
+  static std::array<vk::VertexInputBindingDescription, 2>
+  getBindingDescriptions() {
+    vk::VertexInputBindingDescription desc_x = {};
+    desc_x.binding = 0;
+    desc_x.stride = sizeof(glm::vec3);
+    desc_x.inputRate = vk::VertexInputRate::eVertex;
+    vk::VertexInputBindingDescription desc_c = {};
+    desc_c.binding = 1;
+    desc_c.stride = sizeof(glm::vec3);
+    desc_c.inputRate = vk::VertexInputRate::eVertex;
+    return {desc_x, desc_c};
+  }
+
+  static std::array<vk::VertexInputAttributeDescription, 2>
+  getAttributeDescriptions() {
+    vk::VertexInputAttributeDescription desc_x = {};
+    desc_x.binding = 0;
+    desc_x.location = 0;
+    desc_x.format = getFormat<glm::vec3>(); // vk::Format::eR32G32B32Sfloat;
+    desc_x.offset = 0;
+    vk::VertexInputAttributeDescription desc_c = {};
+    desc_c.binding = 1;
+    desc_c.location = 1;
+    desc_c.format = getFormat<glm::vec3>(); // vk::Format::eR32G32B32Sfloat;
+    desc_c.offset = 0;
+    return {desc_x, desc_c};
+  }
+};
+
+// device buffer holding one attribute stream
+struct GpuStream {
+  vk::Buffer buffer;
+  vk::DeviceMemory mem;
+  // persistently mapped with direct upload, null when staged
+  void* mmap;
+};
+
+using StreamId = StreamCache<GpuStream>::Stream;
+
+// streams of one geometry, indexed by GeometryId; geometries with identical
+// positions, colors or indices share the stream
+struct GpuGeometry {
+  StreamId xs_stream, colors_stream, inds_stream;
+  uint32_t index_count;
+};
+
+using GeometryId = uint32_t;
+using TextureId = uint32_t;
+using MaterialId = uint32_t;
+
+// RGBA8 texels of a texture, only read when uploading
+struct TextureData {
+  uint32_t width, height;
+  // R in the low byte
+  std::vector<uint32_t> texels;
+
+  static TextureData solid(uint32_t rgba) {
+    return {1, 1, {rgba}};
+  }
+
+  static TextureData checker(uint32_t size, uint32_t cell, uint32_t a, uint32_t b) {
+    TextureData data = {size, size, std::vector<uint32_t>(size * size)};
+    for (uint32_t y = 0; y < size; ++y) {
+      for (uint32_t x = 0; x < size; ++x) {
+        data.texels[y * size + x] = (x / cell + y / cell) % 2 ? b : a;
+      }
+    }
+    return data;
+  }
+};
+
+// entry of the material table read by shader.frag (std430)
+struct GpuMaterial {
+  glm::vec4 tint;
+  TextureId texture;
+  uint32_t pad[3];
+};
+static_assert(sizeof(GpuMaterial) == 32);
+
+// sampled image of the bindless texture table
+struct GpuTexture {
+  vk::Image image;
+  vk::DeviceMemory mem;
+  vk::ImageView view;
+};
+
+struct RenderState {
+  // anything below 1 is drawn blended, after all opaque meshes
+  float opacity = 1.0f;
+  // only shaded with --bindless; material 0 is untextured
+  MaterialId material = 0;
+
+  bool isTransparent() const {
+    return opacity < 1.0f;
+  }
+};
+
+// rotation about an axis at a constant rate, applied on top of the node's
+// rest rotation
+struct Animation {
+  glm::vec3 spin_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+  // radians per second
+  float spin_rate = 0.0f;
+};
+
+// Drawable entities, one array per component. The node is also the index
+// of the entity's model matrix on the GPU; bounds are in node space.
+enum MeshComponent : size_t {
+  MESH_NODE,
+  MESH_GEOMETRY,
+  MESH_BOUNDS,
+  MESH_RENDER_STATE,
+  MESH_ANIMATION,
+};
+using MeshStore = ComponentStore<SceneGraph::Node, GeometryId, Bounds, RenderState, Animation>;
+
+// per draw; the camera comes from ViewUniforms
+struct DrawPushConstants {
+  float opacity;
+  MaterialId material;
+};
+// the material is read by shader.frag
+constexpr vk::ShaderStageFlags DRAW_PUSH_STAGES =
+    vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+
+// per node input of transforms.comp (std430)
+struct GpuAnimation {
+  glm::vec4 translation;
+  // x, y, z, w
+  glm::vec4 rotation;
+  glm::vec4 scale;
+  // axis, rate
+  glm::vec4 spin;
+};
+
+// per frame cameras of the vertex shader, one per multiview view
+struct ViewUniforms {
+  glm::mat4 view_projs[MAX_VIEWS];
+};
+
+struct TransformPushConstants {
+  float time;
+  uint32_t count;
+};
+
+struct QueueFamilyIndices {
+  std::optional<uint32_t> graphics_family;
+  std::optional<uint32_t> present_family;
+  bool allAvailable() {
+    return graphics_family.has_value() && present_family.has_value();
+  }
+};
+
+struct SwapChainSupportDetails {
+  vk::SurfaceCapabilitiesKHR caps;
+  std::vector<vk::SurfaceFormatKHR> formats;
+  std::vector<vk::PresentModeKHR> modes;
+  bool isAcceptable() {
+    return !formats.empty() && !modes.empty();
+  }
+};
+
+// input from the GLFW event thread to the render thread
+struct WindowEvent {
+  enum Type : uint32_t {
+    RESIZE,
+    KEY,
+  };
+  Type type;
+  // RESIZE: framebuffer size; KEY: GLFW key and action
+  int a;
+  int b;
+};
+
+// events a frame can fall behind by; when full, further input is dropped
+constexpr uint32_t WINDOW_EVENT_CAPACITY = 256;
+
+using my_clock = std::chrono::high_resolution_clock;
+using my_time = std::chrono::time_point<my_clock>;
+
+inline double deltatime_seconds(const my_time& t, const my_time& s) {
+  auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>(t - s);
+  return dt.count() / (double) SECOND_NS;
+}
+
+// Create infos of the graphics pipelines and everything they point to,
+// kept alive while the pipelines compile on the job system. The vectors
+// hold one entry per description and are sized once, so pointers into
+// them stay valid.
+struct PipelineBuild {
+  std::vector<PipelineDesc> descs;
+  // by shader variant key, shared by the pipelines using it
+  std::unordered_map<std::string, vk::ShaderModule> modules;
+  vk::Bool32 overdraw;
+  vk::SpecializationMapEntry spec_overdraw;
+  vk::SpecializationInfo info_spec;
+  std::vector<std::array<vk::PipelineShaderStageCreateInfo, 2>> stages;
+  std::vector<vk::DynamicState> dynamic_states;
+  vk::PipelineDynamicStateCreateInfo info_dyn;
+  std::array<vk::VertexInputBindingDescription, 2> bindings;
+  std::array<vk::VertexInputAttributeDescription, 2> attributes;
+  vk::PipelineVertexInputStateCreateInfo info_vin;
+  vk::PipelineInputAssemblyStateCreateInfo info_asm;
+  vk::PipelineViewportStateCreateInfo info_vp;
+  vk::PipelineRasterizationStateCreateInfo info_rast;
+  vk::PipelineMultisampleStateCreateInfo info_ms;
+  std::vector<vk::PipelineDepthStencilStateCreateInfo> info_ds;
+  std::vector<vk::PipelineColorBlendAttachmentState> cb_attachments;
+  std::vector<vk::PipelineColorBlendStateCreateInfo> info_cb;
+  std::vector<vk::GraphicsPipelineCreateInfo> infos;
+  // written by the worker that compiled each pipeline
+  std::vector<vk::Result> results;
+  JobCounter compiling;
+  my_time start;
+};
+
+class Framerate {
+ public:
+  void init() {
+    m_start_window = my_clock::now();
+    m_frames = 0;
+  }
+  // returns true when a new measurement was reported
+  bool tick() {
+    m_frames++;
+    my_time now = my_clock::now();
+    double dt = deltatime_seconds(now, m_start_window);
+    if (dt < 1.0) {
+      return false;
+    }
+    auto flags = std::cout.flags();
+    std::cout.precision(2);
+    std::cout << std::fixed << "FPS: " << m_frames / dt << "\n";
+    std::cout.flags(flags);
+    m_start_window = now;
+    m_frames = 0;
+    return true;
+  }
+ private:
+  my_time m_start_window;
+  uint64_t m_frames;
+};
+
+// Swapchain objects replaced by a recreation, destroyed once every frame
+// submitted before the recreation has finished.
+struct RetiredSwapchain {
+  uint64_t frame;
+  vk::SwapchainKHR swapchain;
+  std::vector<vk::ImageView> image_views;
+  std::vector<vk::Framebuffer> fbs;
+  // pre-recorded commands referencing the framebuffers
+  std::vector<vk::CommandBuffer> cmd_bufs;
+  RenderGraph::Garbage graph;
+};
+
+// Textures copied by one submission, written into the texture table once
+// the frame submitted after it has completed. Until then no material may
+// point at them.
+struct TextureUpload {
+  uint64_t frame;
+  TextureId first;
+  uint32_t count;
+  vk::CommandBuffer cmd_buf;
+  std::vector<std::pair<vk::Buffer, vk::DeviceMemory>> staging;
+};
+
+// 8-4-4-4-12 lowercase hex
+inline std::string formatUUID(const std::array<uint8_t, VK_UUID_SIZE>& uuid) {
+  std::string out;
+  const char* digits = "0123456789abcdef";
+  for (size_t i = 0; i < uuid.size(); ++i) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) {
+      out += '-';
+    }
+    out += digits[uuid[i] >> 4];
+    out += digits[uuid[i] & 0xf];
+  }
+  return out;
+}
+
+struct Camera {
+  glm::mat4 view;
+  glm::mat4 proj;
+};
+
+class Application {
+ public:
+  explicit Application(Options options) : m_options(std::move(options)) {}
+
+  // jobs still queued or running when run() throws, whether simulating or
+  // compiling pipelines, would otherwise outlive the members they touch
+  ~Application() {
+    m_jobs.wait(m_sim_done);
+    if (m_pipeline_build) {
+      m_jobs.wait(m_pipeline_build->compiling);
+    }
+  }
+
+  void run() {
+    initGame();
+    if (!m_options.headless) {
+      initWindow();
+    }
+    initVulkan();
+    mainLoop();
+    cleanup();
+  }
+
+  // filled in by run() when it returns
+  const RunReport& report() const {
+    return m_report;
+  }
+
+ private:
+  void initGame() {
+    // global clock
+    m_start = my_clock::now();
+    // defaults, shading with the vertex colors alone
+    addMaterial(glm::vec4(1.0f), addTexture(TextureData::solid(0xffffffff)));
+    if (!m_options.replay.empty()) {
+      loadReplay();
+      return;
+    }
+
+    if (m_options.stress_meshes > 0) {
+      generateStressScene();
+    }
+    else {
+      createDemoScene();
+    }
+
+    // camera
+    auto eye = glm::vec3(2.0f, 2.0f, 2.0f);
+    auto center = glm::vec3();
+    auto up = glm::vec3(0.0f, 0.0f, 1.0f);
+    m_camera.view = glm::lookAt(eye, center, up);
+
+    if (!m_options.capture.empty()) {
+      startCapture();
+    }
+  }
+
+  // the game's quads
+  void createDemoScene() {
+    // geometry
+    m_geometry_data.push_back({
+        .xs = {
+          glm::vec3(0.5, -0.5, 0.0),
+          glm::vec3(-0.5, 0.5, 0.0),
+          glm::vec3(0.5, 0.5, 0.0),
+          glm::vec3(-0.5, -0.5, 0.0),
+        },
+        .colors = {
+          glm::vec3(1.0, 1.0, 1.0),
+          glm::vec3(0.0, 1.0, 0.0),
+          glm::vec3(0.0, 0.0, 1.0),
+          glm::vec3(1.0, 0.0, 0.0),
+        },
+        .inds = {
+          1, 0, 2,
+          0, 1, 3,
+        }
+      });
+    m_geometry_data.push_back(m_geometry_data[0]);
+    m_geometry_data[1].colors = {
+      glm::vec3(0.0, 0.0, 1.0),
+      glm::vec3(1.0, 0.0, 0.0),
+      glm::vec3(0.0, 0.0, 1.0),
+      glm::vec3(1.0, 0.0, 0.0),
+    };
+    m_geometry_data.push_back(m_geometry_data[0]);
+    m_geometry_data[2].colors = {
+      glm::vec3(1.0, 1.0, 1.0),
+      glm::vec3(1.0, 1.0, 1.0),
+      glm::vec3(1.0, 1.0, 1.0),
+      glm::vec3(1.0, 1.0, 1.0),
+    };
+
+    // meshes
+    // dummy dynamics: just rotate each mesh in place
+    Animation spin = {.spin_rate = glm::radians(90.0f)};
+    Entity front = addMesh(0, {}, spin);
+    m_late_material_mesh = front;
+    Entity blended = addMesh(1, {.opacity = 0.5f}, spin);
+    Entity ground = addMesh(2, {}, spin);
+    m_scene.setScale(m_meshes.get<MESH_NODE>(front), glm::vec3(0.5f, 0.5f, 0.5f));
+    m_scene.setTranslation(m_meshes.get<MESH_NODE>(front), glm::vec3(1.0f, 0.0f, 0.0f));
+    m_scene.setTranslation(m_meshes.get<MESH_NODE>(blended), glm::vec3(0.0f, 1.0f, 0.0f));
+    m_scene.setScale(m_meshes.get<MESH_NODE>(ground), glm::vec3(2.0f, 2.0f, 1.0f));
+    m_scene.setTranslation(m_meshes.get<MESH_NODE>(ground), glm::vec3(0.0f, 0.0f, -0.1f));
+    updateScene();
+
+    // materials, used with --bindless
+    m_meshes.get<MESH_RENDER_STATE>(ground).material = addMaterial(
+        glm::vec4(1.0f), addTexture(TextureData::checker(64, 8, 0xffffffff, 0xff808080)));
+  }
+
+  // Benchmark scene: meshes on a square grid filling the camera's view,
+  // each a grid of --stress-triangles triangles. A --stress-instancing
+  // fraction of the meshes reuse another mesh's geometry and a
+  // --stress-animated fraction spin. Seeded, so every run is the same.
+  void generateStressScene() {
+    uint32_t n_meshes = m_options.stress_meshes;
+    auto n_geometries = std::max<uint32_t>(
+        1, (uint32_t)std::lround(n_meshes * (1.0 - m_options.stress_instancing)));
+    std::mt19937 rng(1);
+    for (uint32_t i = 0; i < n_geometries; ++i) {
+      m_geometry_data.push_back(stressGeometry(m_options.stress_triangles, rng));
+    }
+
+    auto side = (uint32_t)std::ceil(std::sqrt((double)n_meshes));
+    float spacing = 2.0f / side;
+    std::bernoulli_distribution animated(m_options.stress_animated);
+    Animation spin = {.spin_rate = glm::radians(90.0f)};
+    for (uint32_t i = 0; i < n_meshes; ++i) {
+      Entity mesh = addMesh(i % n_geometries, {}, animated(rng) ? spin : Animation{});
+      auto node = m_meshes.get<MESH_NODE>(mesh);
+      m_scene.setScale(node, glm::vec3(0.9f * spacing));
+      m_scene.setTranslation(node, glm::vec3(
+          spacing * (i % side + 0.5f) - 1.0f, spacing * (i / side + 0.5f) - 1.0f, 0.0f));
+    }
+    updateScene();
+    std::cout << "Stress scene: " << n_meshes << " meshes of " << m_options.stress_triangles
+              << " triangles, " << n_geometries << " geometries\n";
+  }
+
+  // Grid of quads over the unit square cut into exactly this many
+  // triangles. Depth and colors are random, so no two geometries share a
+  // vertex stream.
+  static GeometryData stressGeometry(uint32_t triangles, std::mt19937& rng) {
+    uint32_t quads = (triangles + 1) / 2;
+    auto cols = (uint32_t)std::ceil(std::sqrt((double)quads));
+    uint32_t rows = (quads + cols - 1) / cols;
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    GeometryData data;
+    for (uint32_t y = 0; y <= rows; ++y) {
+      for (uint32_t x = 0; x <= cols; ++x) {
+        data.xs.push_back(glm::vec3(
+            (float)x / cols - 0.5f, (float)y / rows - 0.5f, 0.05f * unit(rng)));
+        data.colors.push_back(glm::vec3(unit(rng), unit(rng), unit(rng)));
+      }
+    }
+    for (uint32_t i = 0; i < triangles; ++i) {
+      // corners of the quad, counter-clockwise
+      uint32_t quad = i / 2;
+      uint32_t a = quad / cols * (cols + 1) + quad % cols;
+      uint32_t b = a + 1;
+      uint32_t c = b + cols + 1;
+      uint32_t d = a + cols + 1;
+      if (i % 2 == 0) {
+        data.inds.insert(data.inds.end(), {a, b, c});
+      }
+      else {
+        data.inds.insert(data.inds.end(), {a, c, d});
+      }
+    }
+    return data;
+  }
+
+  // geometry and entities come from the capture, frames are applied one at
+  // a time by replayFrame
+  void loadReplay() {
+    m_replay = std::make_unique<capture::Reader>(m_options.replay);
+    for (const auto& geometry : m_replay->geometries()) {
+      m_geometry_data.push_back({geometry.xs, geometry.colors, geometry.inds});
+    }
+    for (uint32_t i = 0; i < m_replay->nodeCount(); ++i) {
+      m_scene.addNode();
+    }
+    for (const auto& entity : m_replay->entities()) {
+      Bounds bounds = {glm::vec3(entity.bounds), entity.bounds.w};
+      m_meshes.create(entity.node, entity.geometry, bounds, {entity.opacity}, {});
+    }
+    if (m_replay->frames().empty()) {
+      throw std::runtime_error("capture " + m_options.replay + " has no frames");
+    }
+    if (m_options.frames == 0) {
+      m_options.frames = m_replay->frames().size();
+    }
+    std::cout << "Replaying " << m_options.frames << " frames of " << m_options.replay
+              << " (" << m_replay->frames().size() << " captured)\n";
+  }
+
+  void startCapture() {
+    m_capture = std::make_unique<capture::Writer>(m_options.capture);
+    for (const auto& data : m_geometry_data) {
+      m_capture->writeGeometry(data.xs, data.colors, data.inds);
+    }
+    const auto& nodes = m_meshes.column<MESH_NODE>();
+    const auto& geometries = m_meshes.column<MESH_GEOMETRY>();
+    const auto& bounds = m_meshes.column<MESH_BOUNDS>();
+    const auto& states = m_meshes.column<MESH_RENDER_STATE>();
+    std::vector<capture::Entity> entities;
+    for (uint32_t i = 0; i < m_meshes.size(); ++i) {
+      entities.push_back({
+          nodes[i], geometries[i], glm::vec4(bounds[i].center, bounds[i].radius),
+          states[i].opacity});
+    }
+    m_capture->writeEntities(m_scene.size(), entities);
+  }
+
+  // Textures and materials are appended to the bindless tables; anything
+  // added after startup is streamed in by streamMaterials. The first of each
+  // are the defaults meshes start out with.
+  TextureId addTexture(TextureData data) {
+    if (m_texture_data.size() == MAX_TEXTURES) {
+      throw std::runtime_error("out of bindless texture slots");
+    }
+    m_texture_data.push_back(std::move(data));
+    return m_texture_data.size() - 1;
+  }
+
+  MaterialId addMaterial(glm::vec4 tint, TextureId texture) {
+    if (m_material_data.size() == MAX_MATERIALS) {
+      throw std::runtime_error("out of bindless material slots");
+    }
+    m_material_data.push_back({tint, texture, {}});
+    return m_material_data.size() - 1;
+  }
+
+  // Content arriving after startup, as it would when streamed: the front
+  // quad switches to a new texture, drawn with the default material until
+  // the texture is resident.
+  void addLateMaterial() {
+    auto texture = addTexture(TextureData::checker(64, 16, 0xffffc040, 0xffffffff));
+    m_meshes.get<MESH_RENDER_STATE>(m_late_material_mesh).material =
+        addMaterial(glm::vec4(1.0f), texture);
+  }
+
+  // new drawable entity with its own transform node
+  Entity addMesh(GeometryId geometry, RenderState state, Animation animation = {}) {
+    return m_meshes.create(
+        m_scene.addNode(), geometry, m_geometry_data[geometry].bounds(), state, animation);
+  }
+
+  void initWindow() {
+    glfwInit();
+    // no OpenGL
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    m_window = glfwCreateWindow(800, 600, "Hello triangle", nullptr, nullptr);
+    int width, height;
+    glfwGetFramebufferSize(m_window, &width, &height);
+    storeFramebufferSize(width, height);
+    // event handlers, run by glfwWaitEvents on the main thread
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetFramebufferSizeCallback(m_window, framebufferResized);
+    glfwSetWindowCloseCallback(m_window, windowClosed);
+    glfwSetKeyCallback(m_window, keyChanged);
+  }
+
+  static void framebufferResized(GLFWwindow* window, int width, int height) {
+    auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+    app->storeFramebufferSize(width, height);
+    app->m_events.push({WindowEvent::RESIZE, width, height});
+  }
+
+  static void windowClosed(GLFWwindow* window) {
+    auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+    app->m_close_requested.store(true);
+  }
+
+  static void keyChanged(
+      GLFWwindow* window, int key, [[maybe_unused]] int scancode, int action,
+      [[maybe_unused]] int mods) {
+    auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+    app->m_events.push({WindowEvent::KEY, key, action});
+  }
+
+  void storeFramebufferSize(int width, int height) {
+    m_fb_size.store((uint64_t(uint32_t(width)) << 32) | uint32_t(height));
+  }
+
+  // latest framebuffer size the event thread has seen; GLFW itself may
+  // only be asked on the main thread
+  vk::Extent2D framebufferExtent() const {
+    uint64_t size = m_fb_size.load();
+    return {uint32_t(size >> 32), uint32_t(size)};
+  }
+
+  // render thread: apply the input queued since the last frame
+  void pollWindowEvents() {
+    WindowEvent event;
+    while (m_events.pop(event)) {
+      switch (event.type) {
+        case WindowEvent::RESIZE:
+          m_fb_resized = true;
+          break;
+        case WindowEvent::KEY:
+          if (event.a == GLFW_KEY_ESCAPE && event.b == GLFW_PRESS) {
+            m_close_requested.store(true);
+          }
+          break;
+      }
+    }
+  }
+
+  void initVulkan() {
+    createVkInstance();
+    if (!m_options.headless) {
+      createVkSurface();
+    }
+    selectVkPhysicalDevice();
+    if (m_options.stress_meshes > 0) {
+      checkStressAllocations();
+    }
+    createVkLogicalDevice();
+    if (m_options.headless) {
+      createVkOffscreenTargets();
+    }
+    else {
+      createVkSwapchain(VK_NULL_HANDLE);
+    }
+    createVkImageViews();
+    if (m_options.frame_budget_ms > 0.0) {
+      checkScaledBlitSupport();
+    }
+    createVkRenderPass();
+    createVkDescriptorSetLayout();
+    createVkGraphicsPipeline(pipelineDescs());
+    if (m_options.gpu_transforms) {
+      createVkComputePipeline();
+    }
+    createVkCommandPool();
+    RenderGraph::Garbage garbage;
+    createVkRenderGraph(garbage);
+    createVkFramebuffers();
+    // TODO: allow meshes to be added/removed dynamically
+    createVkVertexBuffers();
+    if (m_options.bindless) {
+      createVkMaterials();
+    }
+    createVkTransformBuffers();
+    if (!m_options.export_target.empty()) {
+      createVkReadbackBuffers();
+    }
+    createVkCommandBuffers();
+    if (m_options.prerecord) {
+      createVkStaticCommandBuffers();
+    }
+    createVkSyncObjects();
+    if (m_stats_supported) {
+      createVkQueryPool();
+    }
+    if (m_options.frame_budget_ms > 0.0 || m_options.frames > 0) {
+      createVkTimestampPool();
+    }
+  }
+
+  void recreateVkSwapchain() {
+    // pause until we have a non-trivial draw surface (e.g. wait until not
+    // minimized); the old swapchain stays until cleanup if closed meanwhile
+    auto fb_extent = framebufferExtent();
+    while (fb_extent.width == 0 || fb_extent.height == 0) {
+      if (m_close_requested.load()) {
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      pollWindowEvents();
+      fb_extent = framebufferExtent();
+    }
+
+    // no waitIdle: frames in flight keep rendering into the old objects,
+    // which are only destroyed once their fences have signaled
+    RetiredSwapchain retired = {};
+    retired.frame = m_frame_count;
+    retired.swapchain = m_swapchain;
+    retired.image_views = std::move(m_swap_image_views);
+    retired.fbs = std::move(m_swap_fbs);
+    retired.cmd_bufs = std::move(m_static_cmd_bufs);
+    m_swap_image_views.clear();
+    m_swap_fbs.clear();
+    m_static_cmd_bufs.clear();
+    m_graph.reset(retired.graph);
+
+    createVkSwapchain(retired.swapchain);
+    createVkImageViews();
+    // reuses the old depth memory if the new extent fits
+    createVkRenderGraph(retired.graph);
+    createVkFramebuffers();
+    if (m_options.prerecord) {
+      createVkStaticCommandBuffers();
+    }
+    m_retired.push_back(std::move(retired));
+    m_alloc_check_from = m_frame_count + ALLOC_WARMUP_FRAMES;
+  }
+
+  void destroyRetiredSwapchains(bool all) {
+    while (!m_retired.empty()) {
+      auto& retired = m_retired.front();
+      // fences are waited in order, so MAX_FRAMES_IN_FLIGHT frames later
+      // everything that could reference the old swapchain has completed
+      if (!all && m_frame_count < retired.frame + MAX_FRAMES_IN_FLIGHT) {
+        break;
+      }
+      for (auto fb : retired.fbs) {
+        m_device.destroyFramebuffer(fb, nullptr);
+      }
+      for (auto image_view : retired.image_views) {
+        m_device.destroyImageView(image_view, nullptr);
+      }
+      m_device.destroySwapchainKHR(retired.swapchain, nullptr);
+      if (!retired.cmd_bufs.empty()) {
+        m_device.freeCommandBuffers(m_cmd_pool, retired.cmd_bufs.size(), retired.cmd_bufs.data());
+      }
+      RenderGraph::destroyGarbage(m_device, retired.graph);
+      m_retired.pop_front();
+    }
+  }
+
+  void createVkInstance() {
+    if (ENABLE_VALIDATION_LAYERS && !checkValidationLayerSupport()) {
+      throw std::runtime_error("validation layers enabled but not supported\n");
+    }
+
+    vk::ApplicationInfo app_info = {};
+    app_info.sType = vk::StructureType::eApplicationInfo;
+    app_info.pApplicationName = "Hello triangle";
+    app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    app_info.pEngineName = "None";
+    app_info.engineVersion = VK_MAKE_VERSION(0, 0, 0);
+    // 1.1 for device UUIDs
+    app_info.apiVersion = VK_API_VERSION_1_1;
+
+    vk::InstanceCreateInfo inst_info = {};
+    inst_info.sType = vk::StructureType::eInstanceCreateInfo;
+    inst_info.pApplicationInfo = &app_info;
+
+    // surface extensions, unless there is no window
+    if (!m_options.headless) {
+      uint32_t glfw_n_extension = 0;
+      const char** glfw_extensions;
+      glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_n_extension);
+      inst_info.enabledExtensionCount = glfw_n_extension;
+      inst_info.ppEnabledExtensionNames = glfw_extensions;
+    }
+    if (ENABLE_VALIDATION_LAYERS) {
+      inst_info.enabledLayerCount = g_validation_layers.size();
+      inst_info.ppEnabledLayerNames = g_validation_layers.data();
+    }
+
+    auto res = vk::createInstance(&inst_info, nullptr, &m_instance);
+    check(res, "createInstance");
+  }
+
+  void createVkSurface() {
+    auto res = glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface);
+    check(res, "failed to create window surface");
+  }
+
+  // Picks the highest scoring suitable device, or the one named by
+  // --device. An explicit choice that does not match or is not suitable is
+  // an error rather than a silent fallback.
+  void selectVkPhysicalDevice() {
+    uint32_t n_device = 0;
+    auto res = m_instance.enumeratePhysicalDevices(&n_device, nullptr);
+    check(res, "");
+    if (n_device == 0) {
+      throw std::runtime_error("no supported Vulkan devices available");
+    }
+    std::vector<vk::PhysicalDevice> devices(n_device);
+    res = m_instance.enumeratePhysicalDevices(&n_device, devices.data());
+    check(res, "");
+
+    const auto& selector = m_options.device;
+    uint64_t best_score = 0;
+    std::cout << "Vulkan devices:\n";
+    for (uint32_t i = 0; i < devices.size(); ++i) {
+      const auto& device = devices[i];
+      vk::PhysicalDeviceProperties props;
+      device.getProperties(&props);
+      bool suitable = isDeviceSuitable(device);
+      uint64_t score = suitable ? scoreDevice(device) : 0;
+      std::cout << "  [" << i << "] " << props.deviceName
+                << " (" << vk::to_string(props.deviceType)
+                << ", " << formatUUID(getDeviceUUID(device)) << ")"
+                << (suitable ? "" : " unsuitable") << "\n";
+
+      if (!selector.empty()) {
+        if (m_phys_device || !deviceMatches(selector, i, device)) {
+          continue;
+        }
+        if (!suitable) {
+          throw std::runtime_error(
+              "selected device " + std::string(props.deviceName.data()) + " is not suitable");
+        }
+        m_phys_device = device;
+      }
+      else if (suitable && score > best_score) {
+        m_phys_device = device;
+        best_score = score;
+      }
+    }
+    if (m_phys_device == VK_NULL_HANDLE) {
+      if (!selector.empty()) {
+        throw std::runtime_error("no Vulkan device matches \"" + selector + "\"");
+      }
+      throw std::runtime_error("no supported Vulkan devices available");
+    }
+    else {
+      vk::PhysicalDeviceProperties props;
+      m_phys_device.getProperties(&props);
+      std::cout << "Selected GPU: " << props.deviceName << "\n";
+    }
+  }
+
+  // device type first, then total device-local memory
+  uint64_t scoreDevice(const vk::PhysicalDevice& device) {
+    vk::PhysicalDeviceProperties props;
+    device.getProperties(&props);
+    uint64_t type_rank = 0;
+    switch (props.deviceType) {
+      case vk::PhysicalDeviceType::eDiscreteGpu: type_rank = 4; break;
+      case vk::PhysicalDeviceType::eIntegratedGpu: type_rank = 3; break;
+      case vk::PhysicalDeviceType::eVirtualGpu: type_rank = 2; break;
+      case vk::PhysicalDeviceType::eCpu: type_rank = 1; break;
+      default: break;
+    }
+
+    vk::PhysicalDeviceMemoryProperties mem_props;
+    device.getMemoryProperties(&mem_props);
+    uint64_t local_mib = 0;
+    for (uint32_t i = 0; i < mem_props.memoryHeapCount; ++i) {
+      const auto& heap = mem_props.memoryHeaps[i];
+      if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+        local_mib += heap.size >> 20;
+      }
+    }
+    // every suitable device scores above zero
+    return (type_rank << 48) + std::min(local_mib, (uint64_t(1) << 48) - 1) + 1;
+  }
+
+  // selector is an enumeration index, a device UUID (dashes optional) or a
+  // case-insensitive substring of the device name
+  bool deviceMatches(const std::string& selector, uint32_t index, const vk::PhysicalDevice& device) {
+    auto lower = [](std::string str) {
+      std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) {
+        return (char)std::tolower(c);
+      });
+      return str;
+    };
+    auto strip = [](std::string str) {
+      str.erase(std::remove(str.begin(), str.end(), '-'), str.end());
+      return str;
+    };
+    // before the index, as a UUID can be all digits
+    auto uuid = formatUUID(getDeviceUUID(device));
+    if (strip(lower(selector)) == strip(uuid)) {
+      return true;
+    }
+    // longer runs of digits are names, never indices
+    constexpr size_t MAX_INDEX_DIGITS = 4;
+    bool digits = std::all_of(selector.begin(), selector.end(), [](unsigned char c) {
+      return std::isdigit(c) != 0;
+    });
+    if (digits && selector.size() <= MAX_INDEX_DIGITS) {
+      return std::stoul(selector) == index;
+    }
+    vk::PhysicalDeviceProperties props;
+    device.getProperties(&props);
+    return lower(props.deviceName.data()).find(lower(selector)) != std::string::npos;
+  }
+
+  // all zero on devices without Vulkan 1.1
+  std::array<uint8_t, VK_UUID_SIZE> getDeviceUUID(const vk::PhysicalDevice& device) {
+    std::array<uint8_t, VK_UUID_SIZE> uuid = {};
+    vk::PhysicalDeviceProperties props;
+    device.getProperties(&props);
+    if (props.apiVersion < VK_API_VERSION_1_1) {
+      return uuid;
+    }
+    vk::PhysicalDeviceIDProperties id_props = {};
+    id_props.sType = vk::StructureType::ePhysicalDeviceIdProperties;
+    vk::PhysicalDeviceProperties2 props2 = {};
+    props2.sType = vk::StructureType::ePhysicalDeviceProperties2;
+    props2.pNext = &id_props;
+    device.getProperties2(&props2);
+    std::copy(id_props.deviceUUID.begin(), id_props.deviceUUID.end(), uuid.begin());
+    return uuid;
+  }
+
+  void createVkLogicalDevice() {
+    QueueFamilyIndices indices = findQueueFamilies(m_phys_device);
+    std::vector<vk::DeviceQueueCreateInfo> queue_infos;
+    std::set<uint32_t> unique_queue_families = {
+      indices.graphics_family.value(),
+      indices.present_family.value(),
+    };
+
+    float priority = 1.0f;
+
+    for (uint32_t family : unique_queue_families) {
+      vk::DeviceQueueCreateInfo queue_info = {};
+      queue_info.sType = vk::StructureType::eDeviceQueueCreateInfo;
+      queue_info.queueFamilyIndex = family;
+      queue_info.queueCount = 1;
+      queue_info.pQueuePriorities = &priority;
+      queue_infos.push_back(queue_info);
+    }
+
+    vk::PhysicalDeviceFeatures device_features = {};
+    if (m_options.stats) {
+      vk::PhysicalDeviceFeatures supported;
+      m_phys_device.getFeatures(&supported);
+      m_stats_supported = supported.pipelineStatisticsQuery;
+      device_features.pipelineStatisticsQuery = supported.pipelineStatisticsQuery;
+      if (!m_stats_supported) {
+        std::cout << "Pipeline statistics queries not supported, reporting CPU counters only\n";
+      }
+    }
+
+    void* features_next = nullptr;
+    vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexing = {};
+    indexing.sType = vk::StructureType::ePhysicalDeviceDescriptorIndexingFeaturesEXT;
+    if (m_options.bindless) {
+      device_features.shaderSampledImageArrayDynamicIndexing = vk::True;
+      indexing.runtimeDescriptorArray = vk::True;
+      indexing.descriptorBindingPartiallyBound = vk::True;
+      indexing.descriptorBindingSampledImageUpdateAfterBind = vk::True;
+      indexing.descriptorBindingUpdateUnusedWhilePending = vk::True;
+      indexing.pNext = features_next;
+      features_next = &indexing;
+    }
+
+    vk::PhysicalDeviceMultiviewFeatures multiview = {};
+    multiview.sType = vk::StructureType::ePhysicalDeviceMultiviewFeatures;
+    if (m_options.views > 1) {
+      multiview.multiview = vk::True;
+      multiview.pNext = features_next;
+      features_next = &multiview;
+    }
+
+    vk::DeviceCreateInfo device_info = {};
+    device_info.sType = vk::StructureType::eDeviceCreateInfo;
+    device_info.pNext = features_next;
+    device_info.pQueueCreateInfos = queue_infos.data();
+    device_info.queueCreateInfoCount = queue_infos.size();
+    device_info.pEnabledFeatures = &device_features;
+    auto extensions = deviceExtensions();
+    // optional, for the memory use of runs with a report
+    m_memory_budget =
+        supportedExtensions(m_phys_device).count(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) > 0;
+    if (m_memory_budget) {
+      extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    device_info.enabledExtensionCount = extensions.size();
+    device_info.ppEnabledExtensionNames = extensions.data();
+    if (ENABLE_VALIDATION_LAYERS) {
+      device_info.enabledLayerCount = static_cast<uint32_t>(
+          g_validation_layers.size());
+      device_info.ppEnabledLayerNames = g_validation_layers.data();
+      std::cout << "Creating device with validation layers\n";
+    }
+    else {
+      device_info.enabledLayerCount = 0;
+      std::cout << "Creating device with no validation\n";
+    }
+    auto res = m_phys_device.createDevice(&device_info, nullptr, &m_device);
+    check(res, "failed to create logical device");
+
+    m_device.getQueue(indices.graphics_family.value(), 0, &m_graphics_queue);
+    m_device.getQueue(indices.present_family.value(), 0, &m_present_queue);
+  }
+
+  bool supportsMultiview(const vk::PhysicalDevice& device) {
+    vk::PhysicalDeviceMultiviewFeatures features = {};
+    features.sType = vk::StructureType::ePhysicalDeviceMultiviewFeatures;
+    vk::PhysicalDeviceFeatures2 features2 = {};
+    features2.sType = vk::StructureType::ePhysicalDeviceFeatures2;
+    features2.pNext = &features;
+    device.getFeatures2(&features2);
+    vk::PhysicalDeviceMultiviewProperties props = {};
+    props.sType = vk::StructureType::ePhysicalDeviceMultiviewProperties;
+    vk::PhysicalDeviceProperties2 props2 = {};
+    props2.sType = vk::StructureType::ePhysicalDeviceProperties2;
+    props2.pNext = &props;
+    device.getProperties2(&props2);
+    return features.multiview && props.maxMultiviewViewCount >= m_options.views;
+  }
+
+  // Draws index the texture table with a dynamically uniform material, and
+  // textures are written into it while frames that bind it are in flight.
+  // Only asked of devices with the extension.
+  bool supportsDescriptorIndexing(const vk::PhysicalDevice& device) {
+    vk::PhysicalDeviceFeatures features;
+    device.getFeatures(&features);
+    vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexing = {};
+    indexing.sType = vk::StructureType::ePhysicalDeviceDescriptorIndexingFeaturesEXT;
+    vk::PhysicalDeviceFeatures2 features2 = {};
+    features2.sType = vk::StructureType::ePhysicalDeviceFeatures2;
+    features2.pNext = &indexing;
+    device.getFeatures2(&features2);
+    vk::PhysicalDeviceDescriptorIndexingPropertiesEXT props = {};
+    props.sType = vk::StructureType::ePhysicalDeviceDescriptorIndexingPropertiesEXT;
+    vk::PhysicalDeviceProperties2 props2 = {};
+    props2.sType = vk::StructureType::ePhysicalDeviceProperties2;
+    props2.pNext = &props;
+    device.getProperties2(&props2);
+    return features.shaderSampledImageArrayDynamicIndexing
+        && indexing.runtimeDescriptorArray
+        && indexing.descriptorBindingPartiallyBound
+        && indexing.descriptorBindingSampledImageUpdateAfterBind
+        && indexing.descriptorBindingUpdateUnusedWhilePending
+        && props.maxPerStageDescriptorUpdateAfterBindSampledImages >= MAX_TEXTURES
+        && props.maxDescriptorSetUpdateAfterBindSampledImages >= MAX_TEXTURES;
+  }
+
+  // size of each view's tile; the whole target when not multiview
+  vk::Extent2D viewExtent() const {
+    return {m_extent.width / m_options.views, m_extent.height};
+  }
+
+  // the corner of each view's tile the scene is rendered into, smaller
+  // than the tile when --frame-budget has lowered the resolution
+  vk::Extent2D sceneExtent() const {
+    auto extent = viewExtent();
+    float scale = m_render_scale.scale();
+    return {
+      std::max(1u, (uint32_t)(extent.width * scale)),
+      std::max(1u, (uint32_t)(extent.height * scale)),
+    };
+  }
+
+  // the scene is rendered into an intermediate target, then composed into
+  // the backbuffer
+  bool sceneOffscreen() const {
+    return m_options.views > 1 || m_options.frame_budget_ms > 0.0;
+  }
+
+  // the compose pass scales the scene up with a filtered blit
+  void checkScaledBlitSupport() {
+    vk::FormatProperties props;
+    m_phys_device.getFormatProperties(m_format.format, &props);
+    auto needed = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst
+        | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    if ((props.optimalTilingFeatures & needed) != needed) {
+      throw std::runtime_error("output format cannot be blitted with filtering, needed for --frame-budget");
+    }
+  }
+
+  // Every distinct geometry holds its own device memory, so a stress scene
+  // with little instancing can need more allocations than the device
+  // allows. Generated geometries share indices but not vertices.
+  void checkStressAllocations() {
+    vk::PhysicalDeviceProperties props;
+    m_phys_device.getProperties(&props);
+    uint64_t needed = 2 * m_geometry_data.size() + 1 + OTHER_ALLOCATIONS;
+    if (needed > props.limits.maxMemoryAllocationCount) {
+      throw std::runtime_error(
+          "--stress " + std::to_string(m_options.stress_meshes) + " makes "
+          + std::to_string(m_geometry_data.size()) + " geometries, more than the device's "
+          + std::to_string(props.limits.maxMemoryAllocationCount)
+          + " allocations hold; raise --stress-instancing");
+    }
+  }
+
+  void createVkSwapchain(vk::SwapchainKHR old_swapchain) {
+    SwapChainSupportDetails swap_chain_support = querySwapChainSupportKHR(m_phys_device);
+    m_format = selectSwapSurfaceFormatKHR(swap_chain_support.formats);
+    m_present_mode = selectSwapPresentModeKHR(swap_chain_support.modes);
+    m_extent = selectSwapExtentKHR(swap_chain_support.caps);
+    uint32_t n_image = swap_chain_support.caps.minImageCount + 1;
+    n_image = std::min(n_image, swap_chain_support.caps.maxImageCount);
+
+    vk::SwapchainCreateInfoKHR info = {};
+    info.sType =  vk::StructureType::eSwapchainCreateInfoKHR;
+    info.surface = m_surface;
+    info.minImageCount = n_image;
+    info.imageFormat = m_format.format;
+    info.imageColorSpace = m_format.colorSpace;
+    info.imageExtent = m_extent;
+    info.imageArrayLayers = 1;
+    // color attachment: direct render into image
+    // vs. transfer destination: copy from intermediate
+    info.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+    if (sceneOffscreen()) {
+      // the scene is copied in from the intermediate target
+      if (!(swap_chain_support.caps.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst)) {
+        throw std::runtime_error(
+            "swapchain images cannot be copied to, needed for --views and --frame-budget");
+      }
+      info.imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+    }
+    if (!m_options.export_target.empty()) {
+      // frames are copied out for export
+      if (!(swap_chain_support.caps.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc)) {
+        throw std::runtime_error("swapchain images cannot be copied from, needed for --export");
+      }
+      info.imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+
+    QueueFamilyIndices indices = findQueueFamilies(m_phys_device);
+    uint32_t queue_family_indices[] = {
+      indices.graphics_family.value(),
+      indices.present_family.value(),
+    };
+    // for convenience, use shared access mode when queues are distinct
+    // vs. more performant explicit handoffs of exclusive access
+    if (indices.graphics_family != indices.present_family) {
+      info.imageSharingMode = vk::SharingMode::eConcurrent;
+      info.queueFamilyIndexCount = 2;
+      info.pQueueFamilyIndices = queue_family_indices;
+    }
+    else {
+      info.imageSharingMode = vk::SharingMode::eExclusive;
+    }
+
+    info.preTransform = swap_chain_support.caps.currentTransform;
+    info.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
+    info.presentMode = m_present_mode;
+    info.clipped = vk::True;
+    // lets the presentation engine hand over resources from the swapchain
+    // being replaced, which stays valid for frames still in flight
+    info.oldSwapchain = old_swapchain;
+
+    auto res = m_device.createSwapchainKHR(&info, nullptr, &m_swapchain);
+    check(res, "failed to create swap chain");
+
+    res = m_device.getSwapchainImagesKHR(m_swapchain, &n_image, nullptr);
+    check(res, "getSwapchainImagesKHR");
+    m_swap_images.resize(n_image);
+    res = m_device.getSwapchainImagesKHR(m_swapchain, &n_image, m_swap_images.data());
+    check(res, "getSwapchainImagesKHR");
+  }
+
+  // stands in for the swapchain when headless: one image per frame in
+  // flight, reused once that frame's fence has signaled
+  void createVkOffscreenTargets() {
+    m_format = {vk::Format::eB8G8R8A8Unorm, vk::ColorSpaceKHR::eSrgbNonlinear};
+    m_extent = vk::Extent2D{m_options.width, m_options.height};
+    m_swap_images.resize(MAX_FRAMES_IN_FLIGHT);
+    m_offscreen_mems.resize(MAX_FRAMES_IN_FLIGHT);
+    auto usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc
+        | vk::ImageUsageFlagBits::eTransferDst;
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+      createImage(
+          m_extent.width, m_extent.height, m_format.format, vk::ImageTiling::eOptimal,
+          usage, vk::MemoryPropertyFlagBits::eDeviceLocal, m_swap_images[i], m_offscreen_mems[i]);
+    }
+  }
+
+  void createVkImageViews() {
+    m_swap_image_views.resize(m_swap_images.size());
+    for (size_t i = 0; i < m_swap_images.size(); ++i) {
+      m_swap_image_views[i] = createImageView(
+          m_swap_images[i], m_format.format, vk::ImageAspectFlagBits::eColor);
+    }
+  }
+
+  void createImage(
+      uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling,
+      vk::ImageUsageFlags usage_flags, vk::MemoryPropertyFlags mem_flags,
+      vk::Image& image, vk::DeviceMemory& mem) {
+    vk::ImageCreateInfo info = {};
+    info.sType = vk::StructureType::eImageCreateInfo;
+    info.imageType = vk::ImageType::e2D;
+    info.extent.width = width;
+    info.extent.height = height;
+    info.extent.depth = 1;
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.format = format;
+    info.tiling = tiling;
+    info.initialLayout = vk::ImageLayout::eUndefined;
+    info.usage = usage_flags;
+    info.samples = vk::SampleCountFlagBits::e1;
+    info.sharingMode = vk::SharingMode::eExclusive;
+
+    auto res = m_device.createImage(&info, nullptr, &image);
+    check(res, "createImage");
+
+    vk::MemoryRequirements mem_reqs;
+    m_device.getImageMemoryRequirements(image, &mem_reqs);
+
+    vk::MemoryAllocateInfo info_alloc = {};
+    info_alloc.sType = vk::StructureType::eMemoryAllocateInfo;
+    info_alloc.allocationSize = mem_reqs.size;
+    info_alloc.memoryTypeIndex = findMemoryType(mem_reqs.memoryTypeBits, mem_flags);
+
+    res = m_device.allocateMemory(&info_alloc, nullptr, &mem);
+    check(res, "allocateMemory");
+    m_device_allocs[mem] = mem_reqs.size;
+    m_device_live_bytes += mem_reqs.size;
+
+    m_device.bindImageMemory(image, mem, 0);
+  }
+
+  vk::ImageView createImageView(
+      vk::Image image, vk::Format format, vk::ImageAspectFlagBits aspect_flags) {
+    vk::ImageViewCreateInfo info = {};
+    info.sType = vk::StructureType::eImageViewCreateInfo;
+    info.image = image;
+    info.viewType = vk::ImageViewType::e2D;
+    info.format = format;
+    info.components.r = vk::ComponentSwizzle::eIdentity;
+    info.components.g = vk::ComponentSwizzle::eIdentity;
+    info.components.b = vk::ComponentSwizzle::eIdentity;
+    info.components.a = vk::ComponentSwizzle::eIdentity;
+    info.subresourceRange.aspectMask = aspect_flags;
+    info.subresourceRange.baseMipLevel = 0;
+    info.subresourceRange.levelCount = 1;
+    info.subresourceRange.baseArrayLayer = 0;
+    info.subresourceRange.layerCount = 1;
+
+    vk::ImageView image_view;
+    auto res = m_device.createImageView(&info, nullptr, &image_view);
+    check(res, "createImageView");
+
+    return image_view;
+  }
+
+  void createVkRenderPass() {
+    vk::AttachmentDescription color_attach;
+    color_attach.format = m_format.format;
+    color_attach.samples = vk::SampleCountFlagBits::e1;
+    color_attach.loadOp = vk::AttachmentLoadOp::eClear;
+    color_attach.storeOp = vk::AttachmentStoreOp::eStore;
+    color_attach.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    color_attach.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    // layout transitions happen in the render graph
+    color_attach.initialLayout = vk::ImageLayout::eColorAttachmentOptimal;
+    color_attach.finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
+
+    vk::AttachmentDescription depth_attach;
+    depth_attach.format = DEPTH_FORMAT;
+    depth_attach.samples = vk::SampleCountFlagBits::e1;
+    depth_attach.loadOp = vk::AttachmentLoadOp::eClear;
+    depth_attach.storeOp = vk::AttachmentStoreOp::eDontCare;
+    depth_attach.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    depth_attach.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    depth_attach.initialLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    depth_attach.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    vk::AttachmentReference color_attach_ref;
+    color_attach_ref.attachment = 0;
+    color_attach_ref.layout = vk::ImageLayout::eColorAttachmentOptimal;
+    vk::AttachmentReference depth_attach_ref;
+    depth_attach_ref.attachment = 1;
+    depth_attach_ref.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    vk::SubpassDescription subpass;
+    subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_attach_ref;
+    subpass.pDepthStencilAttachment = &depth_attach_ref;
+
+    std::array<vk::AttachmentDescription, 2> attachments = {
+      color_attach, depth_attach
+    };
+    // every view in one go, into the layers of the attachments
+    uint32_t view_mask = (1u << m_options.views) - 1;
+    vk::RenderPassMultiviewCreateInfo info_mv = {};
+    info_mv.sType = vk::StructureType::eRenderPassMultiviewCreateInfo;
+    info_mv.subpassCount = 1;
+    info_mv.pViewMasks = &view_mask;
+    // the cameras look at the same scene
+    info_mv.correlationMaskCount = 1;
+    info_mv.pCorrelationMasks = &view_mask;
+
+    vk::RenderPassCreateInfo info = {};
+    info.sType = vk::StructureType::eRenderPassCreateInfo;
+    info.pNext = m_options.views > 1 ? &info_mv : nullptr;
+    info.attachmentCount = attachments.size();
+    info.pAttachments = attachments.data();
+    info.subpassCount = 1;
+    info.pSubpasses = &subpass;
+    // external dependencies are pipeline barriers emitted by the render graph
+    info.dependencyCount = 0;
+
+    auto res = m_device.createRenderPass(&info, nullptr, &m_render_pass);
+    check(res, "createRenderPass");
+  }
+
+  // The scene pass's pipelines. Opaque draws need theirs for the first
+  // frame; blending has no stand-in that would look right, so transparent
+  // draws, and the overdraw view, wait for their own.
+  std::vector<PipelineDesc> pipelineDescs() const {
+    PipelineDesc opaque = {
+      .id = PIPELINE_OPAQUE,
+      .vert_key = m_options.views > 1
+          ? shaderVariant("shader.vert", {"MULTIVIEW"}) : shaderVariant("shader.vert"),
+      .frag_key = m_options.bindless
+          ? shaderVariant("shader.frag", {"BINDLESS"}) : shaderVariant("shader.frag"),
+      .render_pass = m_render_pass,
+      .immediate = true,
+    };
+    // blended surfaces are tested against, but do not occlude, the scene
+    PipelineDesc transparent = opaque;
+    transparent.id = PIPELINE_TRANSPARENT;
+    transparent.blend = BlendMode::ALPHA;
+    transparent.depth_write = false;
+    transparent.immediate = false;
+    // every fragment counts, hidden or not
+    PipelineDesc overdraw = transparent;
+    overdraw.id = PIPELINE_OVERDRAW;
+    overdraw.overdraw = true;
+    overdraw.blend = BlendMode::ADD;
+    overdraw.depth_test = false;
+    return {opaque, transparent, overdraw};
+  }
+
+  // Compiles one pipeline per description, the immediate ones right away
+  // and the others on the job system, all through one pipeline cache.
+  // Draws use a fallback, or are skipped, until their own pipeline is
+  // ready, see drawPipeline.
+  void createVkGraphicsPipeline(std::vector<PipelineDesc> descs) {
+    m_pipeline_build = std::make_unique<PipelineBuild>();
+    auto& b = *m_pipeline_build;
+    b.start = my_clock::now();
+    b.descs = std::move(descs);
+    size_t n_pipelines = b.descs.size();
+    std::cout << "Built with " << m_shaders.size() << " shader variants\n";
+    for (const auto& desc : b.descs) {
+      for (const auto& key : {desc.vert_key, desc.frag_key}) {
+        if (!b.modules.count(key)) {
+          b.modules[key] = createShaderModule(m_shaders.code(key));
+        }
+      }
+    }
+
+    // overdraw specializes OVERDRAW in shader.frag, so the driver folds
+    // away the branch
+    b.overdraw = vk::True;
+    auto& spec_overdraw = b.spec_overdraw;
+    spec_overdraw.constantID = 0;
+    spec_overdraw.offset = 0;
+    spec_overdraw.size = sizeof(b.overdraw);
+    auto& info_spec = b.info_spec;
+    info_spec.mapEntryCount = 1;
+    info_spec.pMapEntries = &spec_overdraw;
+    info_spec.dataSize = sizeof(b.overdraw);
+    info_spec.pData = &b.overdraw;
+
+    // stages: vertex and frag shader
+    b.stages.resize(n_pipelines);
+    for (size_t i = 0; i < n_pipelines; ++i) {
+      const auto& desc = b.descs[i];
+      auto& [info_v, info_f] = b.stages[i];
+      info_v.sType = vk::StructureType::ePipelineShaderStageCreateInfo;
+      info_v.stage = vk::ShaderStageFlagBits::eVertex;
+      info_v.module = b.modules[desc.vert_key];
+      info_v.pName = "main";
+      info_v.pSpecializationInfo = nullptr;
+      info_f.sType = vk::StructureType::ePipelineShaderStageCreateInfo;
+      info_f.stage = vk::ShaderStageFlagBits::eFragment;
+      info_f.module = b.modules[desc.frag_key];
+      info_f.pName = "main";
+      info_f.pSpecializationInfo = desc.overdraw ? &info_spec : nullptr;
+    }
+
+    // dynamic state
+    auto& dynamic_states = b.dynamic_states;
+    dynamic_states = {
+      vk::DynamicState::eViewport,
+      vk::DynamicState::eScissor,
+    };
+    auto& info_dyn = b.info_dyn;
+    info_dyn.sType = vk::StructureType::ePipelineDynamicStateCreateInfo;
+    info_dyn.dynamicStateCount = dynamic_states.size();
+    info_dyn.pDynamicStates = dynamic_states.data();
+
+    // stage: vertex input
+    auto& info_vin = b.info_vin;
+    info_vin.sType = vk::StructureType::ePipelineVertexInputStateCreateInfo;
+    auto& bindings = b.bindings;
+    auto& attributes = b.attributes;
+    bindings = GeometryData::getBindingDescriptions();
+    attributes = GeometryData::getAttributeDescriptions();
+    info_vin.vertexBindingDescriptionCount = 2;
+    info_vin.pVertexBindingDescriptions = bindings.data();
+    info_vin.vertexAttributeDescriptionCount = 2;
+    info_vin.pVertexAttributeDescriptions = attributes.data();
+
+    // stage: input assembly
+    auto& info_asm = b.info_asm;
+    info_asm.sType = vk::StructureType::ePipelineInputAssemblyStateCreateInfo;
+    info_asm.topology = vk::PrimitiveTopology::eTriangleList;
+    info_asm.primitiveRestartEnable = vk::False;
+
+    // stage: viewport state
+    auto& info_vp = b.info_vp;
+    info_vp.sType = vk::StructureType::ePipelineViewportStateCreateInfo;
+    info_vp.viewportCount = 1;
+    info_vp.scissorCount = 1;
+
+    // stage: rasterization
+    auto& info_rast = b.info_rast;
+    info_rast.sType = vk::StructureType::ePipelineRasterizationStateCreateInfo;
+    info_rast.depthClampEnable = vk::False;
+    info_rast.rasterizerDiscardEnable = vk::False;
+    info_rast.polygonMode = vk::PolygonMode::eFill;
+    info_rast.lineWidth = 1.0f;
+    info_rast.cullMode = vk::CullModeFlagBits::eBack;
+    info_rast.frontFace = vk::FrontFace::eCounterClockwise;
+    info_rast.depthBiasEnable = vk::False;
+
+    // stage: multisampling
+    auto& info_ms = b.info_ms;
+    info_ms.sType = vk::StructureType::ePipelineMultisampleStateCreateInfo;
+    info_ms.sampleShadingEnable = vk::False;
+    info_ms.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+    // stage: depth/stencil testing
+    auto& info_ds = b.info_ds;
+    info_ds.resize(n_pipelines);
+    for (size_t i = 0; i < n_pipelines; ++i) {
+      auto& ds = info_ds[i];
+      ds.sType = vk::StructureType::ePipelineDepthStencilStateCreateInfo;
+      ds.depthTestEnable = b.descs[i].depth_test ? vk::True : vk::False;
+      ds.depthWriteEnable = b.descs[i].depth_write ? vk::True : vk::False;
+      ds.depthCompareOp = vk::CompareOp::eLess;
+      // discard depths outside bound
+      ds.depthBoundsTestEnable = vk::False;
+      ds.minDepthBounds = 0.0f;
+      ds.maxDepthBounds = 1.0f;
+    }
+
+    // stage: color blending, paid for only by pipelines that blend
+    auto& cb_attachments = b.cb_attachments;
+    cb_attachments.resize(n_pipelines);
+    for (size_t i = 0; i < n_pipelines; ++i) {
+      auto& cb_attachment = cb_attachments[i];
+      cb_attachment.colorWriteMask =
+          vk::ColorComponentFlagBits::eR |
+          vk::ColorComponentFlagBits::eG |
+          vk::ColorComponentFlagBits::eB |
+          vk::ColorComponentFlagBits::eA;
+      cb_attachment.blendEnable = vk::False;
+      switch (b.descs[i].blend) {
+        case BlendMode::NONE:
+          break;
+        case BlendMode::ALPHA:
+          cb_attachment.blendEnable = vk::True;
+          cb_attachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+          cb_attachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+          cb_attachment.colorBlendOp = vk::BlendOp::eAdd;
+          cb_attachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+          cb_attachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
+          cb_attachment.alphaBlendOp = vk::BlendOp::eAdd;
+          break;
+        case BlendMode::ADD:
+          cb_attachment.blendEnable = vk::True;
+          cb_attachment.srcColorBlendFactor = vk::BlendFactor::eOne;
+          cb_attachment.dstColorBlendFactor = vk::BlendFactor::eOne;
+          cb_attachment.colorBlendOp = vk::BlendOp::eAdd;
+          cb_attachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+          cb_attachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
+          cb_attachment.alphaBlendOp = vk::BlendOp::eAdd;
+          break;
+      }
+    }
+    auto& info_cb = b.info_cb;
+    info_cb.resize(n_pipelines);
+    for (size_t i = 0; i < info_cb.size(); ++i) {
+      info_cb[i].sType = vk::StructureType::ePipelineColorBlendStateCreateInfo;
+      info_cb[i].logicOpEnable = vk::False;
+      info_cb[i].attachmentCount = 1;
+      info_cb[i].pAttachments = &cb_attachments[i];
+    }
+
+    // pipeline layout
+    vk::PipelineLayoutCreateInfo info_pp = {};
+    info_pp.sType = vk::StructureType::ePipelineLayoutCreateInfo;
+    // any push constants or uniforms go here
+    vk::PushConstantRange push_constant = {};
+    push_constant.offset = 0;
+    push_constant.size = sizeof(DrawPushConstants);
+    push_constant.stageFlags = DRAW_PUSH_STAGES;
+    info_pp.pPushConstantRanges = &push_constant;
+    info_pp.pushConstantRangeCount = 1;
+    std::array<vk::DescriptorSetLayout, 2> set_layouts = {
+      m_transform_set_layout, m_material_set_layout,
+    };
+    info_pp.setLayoutCount = m_options.bindless ? 2 : 1;
+    info_pp.pSetLayouts = set_layouts.data();
+    auto res = m_device.createPipelineLayout(&info_pp, nullptr, &m_pipeline_layout);
+    check(res, "createPipelineLayout");
+
+    auto& infos = b.infos;
+    infos.resize(n_pipelines);
+    for (size_t i = 0; i < infos.size(); ++i) {
+      auto& info = infos[i];
+      info.sType = vk::StructureType::eGraphicsPipelineCreateInfo;
+      info.stageCount = 2;
+      info.pStages = b.stages[i].data();
+      info.pVertexInputState = &info_vin;
+      info.pInputAssemblyState = &info_asm;
+      info.pViewportState = &info_vp;
+      info.pRasterizationState = &info_rast;
+      info.pMultisampleState = &info_ms;
+      info.pDepthStencilState = &info_ds[i];
+      info.pColorBlendState = &info_cb[i];
+      info.pDynamicState = &info_dyn;
+      info.layout = m_pipeline_layout;
+      info.renderPass = b.descs[i].render_pass;
+      info.subpass = 0;
+
+      info.basePipelineHandle = VK_NULL_HANDLE;
+      info.basePipelineIndex = -1;
+    }
+    b.results.resize(n_pipelines);
+
+    // shared by all workers; creating pipelines through it is thread safe
+    vk::PipelineCacheCreateInfo info_cache = {};
+    info_cache.sType = vk::StructureType::ePipelineCacheCreateInfo;
+    res = m_device.createPipelineCache(&info_cache, nullptr, &m_pipeline_cache);
+    check(res, "createPipelineCache");
+
+    for (auto& ready : m_pipeline_ready) {
+      ready.store(false);
+    }
+    m_pipeline_fallbacks.fill(NO_PIPELINE);
+    for (const auto& desc : b.descs) {
+      auto fallback = std::find_if(b.descs.begin(), b.descs.end(), [&](const auto& other) {
+        return other.id == desc.fallback;
+      });
+      if (desc.fallback != NO_PIPELINE && (fallback == b.descs.end() || !fallback->immediate)) {
+        throw std::runtime_error("pipeline fallbacks must be compiled immediately");
+      }
+      m_pipeline_fallbacks[desc.id] = desc.fallback;
+    }
+    auto build = [](void* data, uint32_t begin, uint32_t) {
+      static_cast<Application*>(data)->buildVkPipeline(begin);
+    };
+    for (uint32_t i = 0; i < n_pipelines; ++i) {
+      if (b.descs[i].immediate) {
+        buildVkPipeline(i);
+        check(b.results[i], "createGraphicsPipelines");
+      }
+    }
+    for (uint32_t i = 0; i < n_pipelines; ++i) {
+      if (!b.descs[i].immediate) {
+        m_jobs.submit(build, this, i, i + 1, &b.compiling);
+      }
+    }
+    // without workers nothing compiles until someone waits
+    if (m_jobs.workerCount() == 1) {
+      finishVkPipelines(true);
+    }
+  }
+
+  // any thread: compile the pipeline of one entry of m_pipeline_build
+  void buildVkPipeline(uint32_t entry) {
+    auto& b = *m_pipeline_build;
+    PipelineId pipeline = b.descs[entry].id;
+    b.results[entry] = m_device.createGraphicsPipelines(
+        m_pipeline_cache, 1, &b.infos[entry], nullptr, &m_pipelines[pipeline]);
+    if (b.results[entry] == vk::Result::eSuccess) {
+      m_pipeline_ready[pipeline].store(true, std::memory_order_release);
+    }
+  }
+
+  // Once all pipelines are compiled (blocking until they are with wait),
+  // report failures and release what their create infos used.
+  void finishVkPipelines(bool wait) {
+    if (!m_pipeline_build) {
+      return;
+    }
+    auto& b = *m_pipeline_build;
+    if (!wait && b.compiling.pending.load() > 0) {
+      return;
+    }
+    m_jobs.wait(b.compiling);
+    for (auto res : b.results) {
+      check(res, "createGraphicsPipelines");
+    }
+    for (auto& [key, mod] : b.modules) {
+      m_device.destroy(mod, nullptr);
+    }
+    std::cout << "Pipelines ready after "
+              << deltatime_seconds(my_clock::now(), b.start) * 1000.0 << " ms\n";
+    m_pipeline_build.reset();
+  }
+
+  // The pipeline a draw binds: the overdraw view replaces all of them, and
+  // ones still compiling are replaced by their fallback, NO_PIPELINE if the
+  // draw waits for them.
+  uint32_t drawPipeline(uint64_t key) const {
+    uint32_t pipeline = m_options.overdraw
+        ? (uint32_t)PIPELINE_OVERDRAW : draw_key::pipeline(key);
+    return m_pipeline_ready[pipeline].load(std::memory_order_acquire)
+        ? pipeline : m_pipeline_fallbacks[pipeline];
+  }
+
+  // transforms.comp: animations in binding 0, model matrices out in binding 1
+  void createVkComputePipeline() {
+    vk::ShaderModule comp_mod = createShaderModule(m_shaders.code("transforms.comp"));
+
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {};
+    for (uint32_t i = 0; i < bindings.size(); ++i) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    }
+    vk::DescriptorSetLayoutCreateInfo info_set = {};
+    info_set.sType = vk::StructureType::eDescriptorSetLayoutCreateInfo;
+    info_set.bindingCount = bindings.size();
+    info_set.pBindings = bindings.data();
+    auto res = m_device.createDescriptorSetLayout(&info_set, nullptr, &m_compute_set_layout);
+    check(res, "createDescriptorSetLayout");
+
+    vk::PushConstantRange push_constant = {};
+    push_constant.offset = 0;
+    push_constant.size = sizeof(TransformPushConstants);
+    push_constant.stageFlags = vk::ShaderStageFlagBits::eCompute;
+    vk::PipelineLayoutCreateInfo info_pp = {};
+    info_pp.sType = vk::StructureType::ePipelineLayoutCreateInfo;
+    info_pp.pushConstantRangeCount = 1;
+    info_pp.pPushConstantRanges = &push_constant;
+    info_pp.setLayoutCount = 1;
+    info_pp.pSetLayouts = &m_compute_set_layout;
+    res = m_device.createPipelineLayout(&info_pp, nullptr, &m_compute_pipeline_layout);
+    check(res, "createPipelineLayout");
+
+    vk::ComputePipelineCreateInfo info = {};
+    info.sType = vk::StructureType::eComputePipelineCreateInfo;
+    info.stage.sType = vk::StructureType::ePipelineShaderStageCreateInfo;
+    info.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    info.stage.module = comp_mod;
+    info.stage.pName = "main";
+    // local_size_x_id
+    uint32_t group_size = TRANSFORM_GROUP_SIZE;
+    vk::SpecializationMapEntry spec_group = {};
+    spec_group.constantID = 0;
+    spec_group.offset = 0;
+    spec_group.size = sizeof(group_size);
+    vk::SpecializationInfo info_spec = {};
+    info_spec.mapEntryCount = 1;
+    info_spec.pMapEntries = &spec_group;
+    info_spec.dataSize = sizeof(group_size);
+    info_spec.pData = &group_size;
+    info.stage.pSpecializationInfo = &info_spec;
+    info.layout = m_compute_pipeline_layout;
+    info.basePipelineHandle = VK_NULL_HANDLE;
+    info.basePipelineIndex = -1;
+    res = m_device.createComputePipelines(
+        VK_NULL_HANDLE, 1, &info, nullptr, &m_compute_pipeline);
+    check(res, "createComputePipelines");
+
+    m_device.destroy(comp_mod, nullptr);
+  }
+
+  void createVkFramebuffers() {
+    m_swap_fbs.resize(m_swap_image_views.size());
+    for (size_t i = 0; i < m_swap_image_views.size(); ++i) {
+      // multiview and scaled rendering use the intermediate target instead
+      std::array<vk::ImageView, 2> attachments = {
+        sceneOffscreen() ? m_graph.getImageView(m_rg_views) : m_swap_image_views[i],
+        m_graph.getImageView(m_rg_depth),
+      };
+      vk::FramebufferCreateInfo info = {};
+      info.sType = vk::StructureType::eFramebufferCreateInfo;
+      info.renderPass = m_render_pass;
+      info.attachmentCount = attachments.size();
+      info.pAttachments = attachments.data();
+      info.width = viewExtent().width;
+      info.height = viewExtent().height;
+      // multiview takes its layers from the view mask
+      info.layers = 1;
+
+      auto res = m_device.createFramebuffer(&info, nullptr, &m_swap_fbs[i]);
+      check(res, "createFramebuffer");
+    }
+  }
+
+  void createVkCommandPool() {
+    QueueFamilyIndices queue_family_indices = findQueueFamilies(m_phys_device);
+    vk::CommandPoolCreateInfo info = {};
+    info.sType = vk::StructureType::eCommandPoolCreateInfo;
+    info.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    info.queueFamilyIndex = queue_family_indices.graphics_family.value();
+    auto res = m_device.createCommandPool(&info, nullptr, &m_cmd_pool);
+    check(res, "createCommandPool");
+  }
+
+  void createVkRenderGraph(RenderGraph::Garbage& garbage) {
+    // the swapchain image arrives via the acquire semaphore, which is waited
+    // on at the color attachment output stage; offscreen images are left
+    // as rendered since nothing reads them yet
+    auto final_layout = m_options.headless
+        ? vk::ImageLayout::eUndefined : vk::ImageLayout::ePresentSrcKHR;
+    m_rg_backbuffer = m_graph.importImage(
+        "backbuffer", {m_extent, m_format.format, vk::ImageAspectFlagBits::eColor},
+        vk::ImageLayout::eUndefined, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        final_layout);
+    m_graph.markOutput(m_rg_backbuffer);
+    auto view_extent = viewExtent();
+    m_rg_depth = m_graph.createImage(
+        "depth", {view_extent, DEPTH_FORMAT, vk::ImageAspectFlagBits::eDepth, m_options.views});
+    // full size, of which --frame-budget renders into the sceneExtent corner
+    auto scene_target = m_rg_backbuffer;
+    if (sceneOffscreen()) {
+      m_rg_views = m_graph.createImage(
+          "views", {view_extent, m_format.format, vk::ImageAspectFlagBits::eColor, m_options.views});
+      scene_target = m_rg_views;
+    }
+
+    if (m_options.gpu_transforms) {
+      // the previous frame's vertex shaders must be done with the matrices
+      m_rg_models = m_graph.importBuffer(
+          "models", m_scene.size() * sizeof(glm::mat4), vk::PipelineStageFlagBits::eVertexShader);
+      m_graph.addPass("transforms", [this](vk::CommandBuffer& cmd_buf) {
+        recordTransformPass(cmd_buf);
+      })
+          .write(m_rg_models, RGUsage::eStorageWriteCompute);
+    }
+
+    auto scene = m_graph.addPass("scene", [this](vk::CommandBuffer& cmd_buf) {
+      recordScenePass(cmd_buf);
+    });
+    scene
+        .write(scene_target, RGUsage::eColorAttachment)
+        .write(m_rg_depth, RGUsage::eDepthAttachment);
+    if (m_options.gpu_transforms) {
+      scene.read(m_rg_models, RGUsage::eStorageReadVertex);
+    }
+
+    if (sceneOffscreen()) {
+      m_graph.addPass("compose", [this](vk::CommandBuffer& cmd_buf) {
+        recordComposePass(cmd_buf);
+      })
+          .read(m_rg_views, RGUsage::eTransferSrc)
+          .write(m_rg_backbuffer, RGUsage::eTransferDst);
+    }
+
+    if (!m_options.export_target.empty()) {
+      // readback slots are sized for the first extent
+      if (m_writer && (m_extent.width > m_readback_extent.width
+                       || m_extent.height > m_readback_extent.height)) {
+        throw std::runtime_error("window grew beyond the size --export started with");
+      }
+      // the slot was last written by a copy, long since read by the host
+      m_rg_readback = m_graph.importBuffer(
+          "readback", m_extent.width * m_extent.height * 4,
+          vk::PipelineStageFlagBits::eTransfer);
+      m_graph.markOutput(m_rg_readback);
+      m_graph.addPass("readback", [this](vk::CommandBuffer& cmd_buf) {
+        recordReadbackPass(cmd_buf);
+      })
+          .read(m_rg_backbuffer, RGUsage::eTransferSrc)
+          .write(m_rg_readback, RGUsage::eTransferDst);
+    }
+
+    vk::PhysicalDeviceMemoryProperties mem_props;
+    m_phys_device.getMemoryProperties(&mem_props);
+    m_graph.compile(m_device, mem_props, garbage);
+  }
+
+  // frees memory from createVkBuffer or createImage
+  void freeVkMemory(vk::DeviceMemory mem) {
+    auto alloc = m_device_allocs.find(mem);
+    if (alloc != m_device_allocs.end()) {
+      m_device_live_bytes -= alloc->second;
+      m_device_allocs.erase(alloc);
+    }
+    m_device.freeMemory(mem, nullptr);
+  }
+
+  // Device memory in use by this process: as the driver accounts it with
+  // VK_EXT_memory_budget, otherwise what createVkBuffer and createImage
+  // hold, which leaves out the render graph's heaps.
+  uint64_t deviceMemoryInUse() {
+    if (!m_memory_budget) {
+      return m_device_live_bytes;
+    }
+    vk::PhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+    budget.sType = vk::StructureType::ePhysicalDeviceMemoryBudgetPropertiesEXT;
+    vk::PhysicalDeviceMemoryProperties2 props2 = {};
+    props2.sType = vk::StructureType::ePhysicalDeviceMemoryProperties2;
+    props2.pNext = &budget;
+    m_phys_device.getMemoryProperties2(&props2);
+    uint64_t used = 0;
+    for (uint32_t i = 0; i < props2.memoryProperties.memoryHeapCount; ++i) {
+      used += budget.heapUsage[i];
+    }
+    return used;
+  }
+
+  void createVkBuffer(
+      vk::DeviceSize size, vk::BufferUsageFlags usage_flags,
+      vk::MemoryPropertyFlags mem_flags,
+      vk::Buffer& buffer, vk::DeviceMemory& mem) {
+    vk::BufferCreateInfo info_buf = {};
+    info_buf.sType = vk::StructureType::eBufferCreateInfo;
+    info_buf.size = size;
+    info_buf.usage = usage_flags;
+    // exclusive to the graphics queue
+    info_buf.sharingMode = vk::SharingMode::eExclusive;
+    auto res = m_device.createBuffer(&info_buf, nullptr, &buffer);
+    check(res, "createBuffer");
+
+    vk::MemoryRequirements mem_reqs;
+    m_device.getBufferMemoryRequirements(buffer, &mem_reqs);
+    vk::MemoryAllocateInfo info_mem = {};
+    info_mem.sType = vk::StructureType::eMemoryAllocateInfo;
+    info_mem.allocationSize = mem_reqs.size;
+    info_mem.memoryTypeIndex = findMemoryType(mem_reqs.memoryTypeBits, mem_flags);
+    res = m_device.allocateMemory(&info_mem, nullptr, &mem);
+    check(res, "allocateMemory");
+    m_device_allocs[mem] = mem_reqs.size;
+    m_device_live_bytes += mem_reqs.size;
+
+    m_device.bindBufferMemory(buffer, mem, 0);
+  }
+
+  void createVkDescriptorSetLayout() {
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {};
+    // model matrices, indexed by gl_InstanceIndex (firstInstance = node)
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = vk::DescriptorType::eStorageBuffer;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = vk::ShaderStageFlagBits::eVertex;
+    // cameras, indexed by gl_ViewIndex with multiview; placed in the frame
+    // arena by a dynamic offset
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = vk::ShaderStageFlagBits::eVertex;
+
+    vk::DescriptorSetLayoutCreateInfo info = {};
+    info.sType = vk::StructureType::eDescriptorSetLayoutCreateInfo;
+    info.bindingCount = bindings.size();
+    info.pBindings = bindings.data();
+    auto res = m_device.createDescriptorSetLayout(&info, nullptr, &m_transform_set_layout);
+    check(res, "createDescriptorSetLayout");
+
+    if (m_options.bindless) {
+      createVkMaterialSetLayout();
+    }
+  }
+
+  // Set 1 with --bindless: the material table and every texture. Texture
+  // slots are written after the set is bound, possibly while frames using
+  // it are in flight, and only those in use need to be valid.
+  void createVkMaterialSetLayout() {
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = vk::DescriptorType::eStorageBuffer;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = vk::ShaderStageFlagBits::eFragment;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    bindings[1].descriptorCount = MAX_TEXTURES;
+    bindings[1].stageFlags = vk::ShaderStageFlagBits::eFragment;
+
+    std::array<vk::DescriptorBindingFlagsEXT, 2> binding_flags = {};
+    binding_flags[1] = vk::DescriptorBindingFlagBitsEXT::ePartiallyBound
+        | vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind
+        | vk::DescriptorBindingFlagBitsEXT::eUpdateUnusedWhilePending;
+    vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT info_flags = {};
+    info_flags.sType = vk::StructureType::eDescriptorSetLayoutBindingFlagsCreateInfoEXT;
+    info_flags.bindingCount = binding_flags.size();
+    info_flags.pBindingFlags = binding_flags.data();
+
+    vk::DescriptorSetLayoutCreateInfo info = {};
+    info.sType = vk::StructureType::eDescriptorSetLayoutCreateInfo;
+    info.pNext = &info_flags;
+    info.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT;
+    info.bindingCount = bindings.size();
+    info.pBindings = bindings.data();
+    auto res = m_device.createDescriptorSetLayout(&info, nullptr, &m_material_set_layout);
+    check(res, "createDescriptorSetLayout");
+  }
+
+  // One persistently mapped model matrix buffer per frame in flight. Each
+  // frame only copies the matrices that changed since that buffer was last
+  // written. With GPU transforms all frames instead read the one buffer the
+  // transform pass writes.
+  void createVkTransformBuffers() {
+    vk::DeviceSize size = std::max<size_t>(m_scene.size(), 1) * sizeof(glm::mat4);
+    if (m_options.gpu_transforms) {
+      createVkGpuTransformBuffers(size);
+    }
+    else {
+      auto usage = vk::BufferUsageFlagBits::eStorageBuffer;
+      auto mem_flags = vk::MemoryPropertyFlagBits::eHostVisible
+          | vk::MemoryPropertyFlagBits::eHostCoherent;
+      for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        createVkBuffer(size, usage, mem_flags, m_transform_buffers[i], m_transform_mems[i]);
+        void* mmap;
+        auto res = m_device.mapMemory(m_transform_mems[i], 0, size, {}, &mmap);
+        check(res, "failed to map GPU buffer");
+        m_transform_mmaps[i] = static_cast<glm::mat4*>(mmap);
+      }
+    }
+    createVkFrameArena();
+
+    // plus the compute set's animations and models
+    std::array<vk::DescriptorPoolSize, 2> pool_sizes = {};
+    pool_sizes[0].type = vk::DescriptorType::eStorageBuffer;
+    pool_sizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT + 2;
+    pool_sizes[1].type = vk::DescriptorType::eUniformBufferDynamic;
+    pool_sizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+    vk::DescriptorPoolCreateInfo info_pool = {};
+    info_pool.sType = vk::StructureType::eDescriptorPoolCreateInfo;
+    info_pool.maxSets = MAX_FRAMES_IN_FLIGHT + 1;
+    info_pool.poolSizeCount = pool_sizes.size();
+    info_pool.pPoolSizes = pool_sizes.data();
+    auto res = m_device.createDescriptorPool(&info_pool, nullptr, &m_descriptor_pool);
+    check(res, "createDescriptorPool");
+
+    std::array<vk::DescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+    layouts.fill(m_transform_set_layout);
+    vk::DescriptorSetAllocateInfo info_alloc = {};
+    info_alloc.sType = vk::StructureType::eDescriptorSetAllocateInfo;
+    info_alloc.descriptorPool = m_descriptor_pool;
+    info_alloc.descriptorSetCount = layouts.size();
+    info_alloc.pSetLayouts = layouts.data();
+    res = m_device.allocateDescriptorSets(&info_alloc, m_transform_sets.data());
+    check(res, "allocateDescriptorSets");
+
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+      vk::DescriptorBufferInfo info_buf = {};
+      info_buf.buffer = m_options.gpu_transforms ? m_models_buffer : m_transform_buffers[i];
+      info_buf.offset = 0;
+      info_buf.range = VK_WHOLE_SIZE;
+      vk::WriteDescriptorSet write = {};
+      write.sType = vk::StructureType::eWriteDescriptorSet;
+      write.dstSet = m_transform_sets[i];
+      write.dstBinding = 0;
+      write.dstArrayElement = 0;
+      write.descriptorCount = 1;
+      write.descriptorType = vk::DescriptorType::eStorageBuffer;
+      write.pBufferInfo = &info_buf;
+      m_device.updateDescriptorSets(1, &write, 0, nullptr);
+
+      // the dynamic offset picks this frame's copy
+      vk::DescriptorBufferInfo info_views = {};
+      info_views.buffer = m_frame_buffer;
+      info_views.offset = 0;
+      info_views.range = sizeof(ViewUniforms);
+      write.dstBinding = 1;
+      write.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+      write.pBufferInfo = &info_views;
+      m_device.updateDescriptorSets(1, &write, 0, nullptr);
+    }
+
+    if (m_options.gpu_transforms) {
+      writeVkComputeDescriptorSet();
+    }
+  }
+
+  // One persistently mapped buffer for data rewritten every frame, with a
+  // region per frame in flight. Ranges are aligned for use as both uniform
+  // and storage buffers.
+  void createVkFrameArena() {
+    vk::PhysicalDeviceProperties props;
+    m_phys_device.getProperties(&props);
+    m_frame_align = (uint32_t)std::max(
+        props.limits.minUniformBufferOffsetAlignment,
+        props.limits.minStorageBufferOffsetAlignment);
+    uint32_t region_size = (FRAME_ARENA_SIZE + m_frame_align - 1) & ~(m_frame_align - 1);
+
+    vk::DeviceSize size = region_size * MAX_FRAMES_IN_FLIGHT;
+    auto usage = vk::BufferUsageFlagBits::eUniformBuffer
+        | vk::BufferUsageFlagBits::eStorageBuffer;
+    auto mem_flags = vk::MemoryPropertyFlagBits::eHostVisible
+        | vk::MemoryPropertyFlagBits::eHostCoherent;
+    createVkBuffer(size, usage, mem_flags, m_frame_buffer, m_frame_mem);
+    void* mmap;
+    auto res = m_device.mapMemory(m_frame_mem, 0, size, {}, &mmap);
+    check(res, "failed to map GPU buffer");
+    m_frame_alloc = FrameAllocator(mmap, region_size, MAX_FRAMES_IN_FLIGHT);
+  }
+
+  // Device-local model matrices, written only by the transform pass, and
+  // the animation inputs it reads, uploaded once. Animation works on the
+  // rest pose of each node in isolation, so parented nodes are not supported.
+  void createVkGpuTransformBuffers(vk::DeviceSize models_size) {
+    std::vector<GpuAnimation> animations(std::max<size_t>(m_scene.size(), 1));
+    for (SceneGraph::Node node = 0; node < m_scene.size(); ++node) {
+      if (m_scene.parent(node) != SceneGraph::NO_PARENT) {
+        throw std::runtime_error("--gpu-transforms does not support parented nodes");
+      }
+      auto rot = m_scene.rotation(node);
+      animations[node] = {
+        glm::vec4(m_scene.translation(node), 1.0f),
+        glm::vec4(rot.x, rot.y, rot.z, rot.w),
+        glm::vec4(m_scene.scale(node), 0.0f),
+        glm::vec4(0.0f),
+      };
+    }
+    const auto& nodes = m_meshes.column<MESH_NODE>();
+    const auto& anims = m_meshes.column<MESH_ANIMATION>();
+    for (uint32_t i = 0; i < m_meshes.size(); ++i) {
+      animations[nodes[i]].spin = glm::vec4(anims[i].spin_axis, anims[i].spin_rate);
+    }
+
+    std::vector<vk::Fence> xfer_fences;
+    std::vector<vk::CommandBuffer> xfer_cmd_bufs;
+    std::vector<std::pair<vk::Buffer, vk::DeviceMemory>> staging;
+    createVkDeviceBuffer(
+        animations.data(), sizeof_vec(animations), vk::BufferUsageFlagBits::eStorageBuffer,
+        m_animations_buffer, m_animations_mem, m_animations_mmap,
+        staging, xfer_cmd_bufs, xfer_fences);
+    finishUploads(xfer_cmd_bufs, xfer_fences, staging);
+
+    createVkBuffer(
+        models_size, vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, m_models_buffer, m_models_mem);
+  }
+
+  void writeVkComputeDescriptorSet() {
+    vk::DescriptorSetAllocateInfo info_alloc = {};
+    info_alloc.sType = vk::StructureType::eDescriptorSetAllocateInfo;
+    info_alloc.descriptorPool = m_descriptor_pool;
+    info_alloc.descriptorSetCount = 1;
+    info_alloc.pSetLayouts = &m_compute_set_layout;
+    auto res = m_device.allocateDescriptorSets(&info_alloc, &m_compute_set);
+    check(res, "allocateDescriptorSets");
+
+    std::array<vk::DescriptorBufferInfo, 2> info_bufs = {};
+    info_bufs[0].buffer = m_animations_buffer;
+    info_bufs[1].buffer = m_models_buffer;
+    std::array<vk::WriteDescriptorSet, 2> writes = {};
+    for (uint32_t i = 0; i < writes.size(); ++i) {
+      info_bufs[i].offset = 0;
+      info_bufs[i].range = VK_WHOLE_SIZE;
+      writes[i].sType = vk::StructureType::eWriteDescriptorSet;
+      writes[i].dstSet = m_compute_set;
+      writes[i].dstBinding = i;
+      writes[i].dstArrayElement = 0;
+      writes[i].descriptorCount = 1;
+      writes[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+      writes[i].pBufferInfo = &info_bufs[i];
+    }
+    m_device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+  }
+
+  // The main camera; with multiview, the views are spread evenly around the
+  // scene's up axis starting from it.
+  void uploadViews() {
+    auto& views = *m_frame_alloc.alloc<ViewUniforms>(m_frame_align, m_view_offset);
+    for (uint32_t i = 0; i < m_options.views; ++i) {
+      float angle = glm::two_pi<float>() * i / m_options.views;
+      auto orbit = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
+      views.view_projs[i] = m_camera.proj * m_camera.view * orbit;
+    }
+  }
+
+  // Host-visible copies of finished frames, preferably cached so the writer
+  // thread reads them at memory speed. A slot goes to the frame writer once
+  // its frame's fence has signaled and is reused when the writer is done.
+  void createVkReadbackBuffers() {
+    vk::PhysicalDeviceMemoryProperties props;
+    m_phys_device.getMemoryProperties(&props);
+    auto cached = vk::MemoryPropertyFlagBits::eHostVisible
+        | vk::MemoryPropertyFlagBits::eHostCached;
+    auto mem_flags = vk::MemoryPropertyFlagBits::eHostVisible
+        | vk::MemoryPropertyFlagBits::eHostCoherent;
+    for (uint32_t i = 0; i < props.memoryTypeCount; ++i) {
+      if ((props.memoryTypes[i].propertyFlags & cached) == cached) {
+        mem_flags = props.memoryTypes[i].propertyFlags;
+        break;
+      }
+    }
+    m_readback_coherent = bool(mem_flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    m_readback_extent = m_extent;
+    vk::DeviceSize size = m_extent.width * m_extent.height * 4;
+    std::vector<const uint8_t*> slots;
+    for (uint32_t i = 0; i < READBACK_SLOTS; ++i) {
+      createVkBuffer(
+          size, vk::BufferUsageFlagBits::eTransferDst, mem_flags,
+          m_readback_buffers[i], m_readback_mems[i]);
+      void* mmap;
+      auto res = m_device.mapMemory(m_readback_mems[i], 0, size, {}, &mmap);
+      check(res, "failed to map GPU buffer");
+      slots.push_back(static_cast<const uint8_t*>(mmap));
+    }
+    m_frame_slots.fill(NO_SLOT);
+    bool bgra = m_format.format == vk::Format::eB8G8R8A8Unorm
+        || m_format.format == vk::Format::eB8G8R8A8Srgb;
+    m_writer = std::make_unique<FrameWriter>(
+        m_options.export_target, std::move(slots), m_extent.width, m_extent.height, bgra);
+  }
+
+  // hand the frame that last used this frame-in-flight to the writer; its
+  // fence has signaled (or the device is idle)
+  void collectReadback(uint32_t frame) {
+    uint32_t slot = m_frame_slots[frame];
+    if (slot == NO_SLOT) {
+      return;
+    }
+    if (!m_readback_coherent) {
+      vk::MappedMemoryRange range = {};
+      range.sType = vk::StructureType::eMappedMemoryRange;
+      range.memory = m_readback_mems[slot];
+      range.offset = 0;
+      range.size = VK_WHOLE_SIZE;
+      auto res = m_device.invalidateMappedMemoryRanges(1, &range);
+      check(res, "invalidateMappedMemoryRanges");
+    }
+    const auto& extent = m_frame_extents[frame];
+    m_writer->push(slot, m_frame_numbers[frame], extent.width, extent.height);
+    m_frame_slots[frame] = NO_SLOT;
+  }
+
+  void uploadTransforms() {
+    auto& pending = m_transform_pending[m_frame];
+    const glm::mat4* world = m_scene.worldData();
+    for (const auto& range : pending) {
+      memcpy(m_transform_mmaps[m_frame] + range.first, world + range.first,
+             range.count * sizeof(glm::mat4));
+      m_transforms_uploaded += range.count;
+    }
+    pending.clear();
+  }
+
+  void createVkVertexBuffers() {
+    std::vector<vk::Fence> xfer_fences;
+    std::vector<vk::CommandBuffer> xfer_cmd_bufs;
+    std::vector<std::pair<vk::Buffer, vk::DeviceMemory>> staging;
+    m_direct_upload = supportsDirectUpload();
+    std::cout << "Geometry upload: " << (m_direct_upload ? "direct" : "staged") << "\n";
+
+    auto usage_verts = vk::BufferUsageFlagBits::eVertexBuffer;
+    auto usage_inds = vk::BufferUsageFlagBits::eIndexBuffer;
+    auto create = [&](vk::BufferUsageFlags usage) {
+      return [&, usage](const void* data, size_t size) {
+        GpuStream stream = {};
+        createVkDeviceBuffer(
+            data, size, usage, stream.buffer, stream.mem, stream.mmap,
+            staging, xfer_cmd_bufs, xfer_fences);
+        return stream;
+      };
+    };
+    for (const auto& data : m_geometry_data) {
+      GpuGeometry gpu = {};
+      // position buffer
+      gpu.xs_stream = m_vertex_streams.acquire(
+          data.xs.data(), sizeof_vec(data.xs), create(usage_verts));
+      // non-position buffer (colors, normals, etc.)
+      gpu.colors_stream = m_vertex_streams.acquire(
+          data.colors.data(), sizeof_vec(data.colors), create(usage_verts));
+      // indices buffer
+      gpu.inds_stream = m_index_streams.acquire(
+          data.inds.data(), sizeof_vec(data.inds), create(usage_inds));
+      gpu.index_count = data.inds.size();
+      m_gpu_geometry.push_back(gpu);
+      // bound the staging memory and allocations alive at once
+      if (m_gpu_geometry.size() % UPLOAD_BATCH == 0) {
+        finishUploads(xfer_cmd_bufs, xfer_fences, staging);
+      }
+    }
+
+    finishUploads(xfer_cmd_bufs, xfer_fences, staging);
+    std::cout << "Geometry streams: "
+              << m_vertex_streams.size() + m_index_streams.size() << " unique for "
+              << 3 * m_gpu_geometry.size() << " used, "
+              << m_vertex_streams.sharedBytes() + m_index_streams.sharedBytes()
+              << " bytes shared\n";
+  }
+
+  // The bindless tables: a host-visible material array and a descriptor
+  // array of every texture, in one set bound once per scene pass. Both are
+  // append-only, so frames in flight never see an entry change.
+  void createVkMaterials() {
+    vk::SamplerCreateInfo info_sampler = {};
+    info_sampler.sType = vk::StructureType::eSamplerCreateInfo;
+    info_sampler.magFilter = vk::Filter::eLinear;
+    info_sampler.minFilter = vk::Filter::eLinear;
+    info_sampler.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    info_sampler.addressModeU = vk::SamplerAddressMode::eRepeat;
+    info_sampler.addressModeV = vk::SamplerAddressMode::eRepeat;
+    info_sampler.addressModeW = vk::SamplerAddressMode::eRepeat;
+    info_sampler.maxLod = 0.0f;
+    auto res = m_device.createSampler(&info_sampler, nullptr, &m_sampler);
+    check(res, "createSampler");
+
+    vk::DeviceSize size = MAX_MATERIALS * sizeof(GpuMaterial);
+    auto mem_flags = vk::MemoryPropertyFlagBits::eHostVisible
+        | vk::MemoryPropertyFlagBits::eHostCoherent;
+    createVkBuffer(
+        size, vk::BufferUsageFlagBits::eStorageBuffer, mem_flags,
+        m_material_buffer, m_material_mem);
+    void* mmap;
+    res = m_device.mapMemory(m_material_mem, 0, size, {}, &mmap);
+    check(res, "failed to map GPU buffer");
+    m_material_mmap = static_cast<GpuMaterial*>(mmap);
+
+    std::array<vk::DescriptorPoolSize, 2> pool_sizes = {};
+    pool_sizes[0].type = vk::DescriptorType::eStorageBuffer;
+    pool_sizes[0].descriptorCount = 1;
+    pool_sizes[1].type = vk::DescriptorType::eCombinedImageSampler;
+    pool_sizes[1].descriptorCount = MAX_TEXTURES;
+    vk::DescriptorPoolCreateInfo info_pool = {};
+    info_pool.sType = vk::StructureType::eDescriptorPoolCreateInfo;
+    info_pool.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT;
+    info_pool.maxSets = 1;
+    info_pool.poolSizeCount = pool_sizes.size();
+    info_pool.pPoolSizes = pool_sizes.data();
+    res = m_device.createDescriptorPool(&info_pool, nullptr, &m_material_pool);
+    check(res, "createDescriptorPool");
+
+    vk::DescriptorSetAllocateInfo info_alloc = {};
+    info_alloc.sType = vk::StructureType::eDescriptorSetAllocateInfo;
+    info_alloc.descriptorPool = m_material_pool;
+    info_alloc.descriptorSetCount = 1;
+    info_alloc.pSetLayouts = &m_material_set_layout;
+    res = m_device.allocateDescriptorSets(&info_alloc, &m_material_set);
+    check(res, "allocateDescriptorSets");
+
+    vk::DescriptorBufferInfo info_buf = {};
+    info_buf.buffer = m_material_buffer;
+    info_buf.offset = 0;
+    info_buf.range = VK_WHOLE_SIZE;
+    vk::WriteDescriptorSet write = {};
+    write.sType = vk::StructureType::eWriteDescriptorSet;
+    write.dstSet = m_material_set;
+    write.dstBinding = 0;
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = vk::DescriptorType::eStorageBuffer;
+    write.pBufferInfo = &info_buf;
+    m_device.updateDescriptorSets(1, &write, 0, nullptr);
+
+    // the startup content is resident before the first frame
+    uploadTextures();
+    res = m_graphics_queue.waitIdle();
+    check(res, "waitIdle");
+    retireTextureUploads(true);
+    uploadMaterials();
+    std::cout << "Bindless tables: " << m_textures.size() << " textures, "
+              << m_materials_uploaded << " materials\n";
+  }
+
+  // Streams textures and materials added since the last frame into the
+  // bindless tables, without waiting on the GPU. Texture slots are written
+  // with update-after-bind, so neither the bound set nor any recorded
+  // command buffer is disturbed. Called once this frame's fence has signaled.
+  void streamMaterials() {
+    retireTextureUploads(false);
+    if (m_textures.size() < m_texture_data.size()
+        || m_materials_uploaded < m_material_data.size()) {
+      // uploading allocates; give the frames after it time to settle
+      m_alloc_check_from = m_frame_count + ALLOC_WARMUP_FRAMES;
+    }
+    uploadTextures();
+    uploadMaterials();
+  }
+
+  // Records the copies of textures added since the last call into one
+  // command buffer, submitted ahead of this frame. The fence of the frame
+  // then also covers the copies.
+  void uploadTextures() {
+    if (m_textures.size() == m_texture_data.size()) {
+      return;
+    }
+    TextureUpload upload = {};
+    upload.frame = m_frame_count;
+    upload.first = m_textures.size();
+    upload.count = m_texture_data.size() - m_textures.size();
+    upload.cmd_buf = beginUpload();
+    for (uint32_t i = upload.first; i < m_texture_data.size(); ++i) {
+      m_textures.push_back(createVkTexture(m_texture_data[i], upload.cmd_buf, upload.staging));
+    }
+    upload.cmd_buf.end();
+
+    vk::SubmitInfo info_submit = {};
+    info_submit.sType = vk::StructureType::eSubmitInfo;
+    info_submit.commandBufferCount = 1;
+    info_submit.pCommandBuffers = &upload.cmd_buf;
+    auto res = m_graphics_queue.submit(1, &info_submit, VK_NULL_HANDLE);
+    check(res, "failed to submit command buffer");
+    m_texture_uploads.push_back(std::move(upload));
+  }
+
+  // binds the textures of finished uploads into the table and frees what
+  // the copies used; all only once the device is idle
+  void retireTextureUploads(bool all) {
+    while (!m_texture_uploads.empty()) {
+      auto& upload = m_texture_uploads.front();
+      // fences are waited in order, so MAX_FRAMES_IN_FLIGHT frames later
+      // the frame submitted after the copies has completed
+      if (!all && m_frame_count < upload.frame + MAX_FRAMES_IN_FLIGHT) {
+        break;
+      }
+      for (uint32_t i = upload.first; i < upload.first + upload.count; ++i) {
+        vk::DescriptorImageInfo info_image = {};
+        info_image.sampler = m_sampler;
+        info_image.imageView = m_textures[i].view;
+        info_image.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        vk::WriteDescriptorSet write = {};
+        write.sType = vk::StructureType::eWriteDescriptorSet;
+        write.dstSet = m_material_set;
+        write.dstBinding = 1;
+        write.dstArrayElement = i;
+        write.descriptorCount = 1;
+        write.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        write.pImageInfo = &info_image;
+        m_device.updateDescriptorSets(1, &write, 0, nullptr);
+      }
+      m_textures_bound = upload.first + upload.count;
+      m_device.freeCommandBuffers(m_cmd_pool, 1, &upload.cmd_buf);
+      for (auto& [buffer, mem] : upload.staging) {
+        m_device.destroyBuffer(buffer, nullptr);
+        freeVkMemory(mem);
+      }
+      m_texture_uploads.pop_front();
+    }
+  }
+
+  // Copies materials into the table in order, each once its texture is
+  // bound. Entries past m_materials_uploaded are never read (drawMaterial),
+  // and the memory is coherent, so no frame in flight sees a partial write.
+  void uploadMaterials() {
+    while (m_materials_uploaded < m_material_data.size()
+           && m_material_data[m_materials_uploaded].texture < m_textures_bound) {
+      m_material_mmap[m_materials_uploaded] = m_material_data[m_materials_uploaded];
+      m_materials_uploaded++;
+    }
+  }
+
+  // the material a draw is shaded with: its own once uploaded, the default
+  // until then
+  MaterialId drawMaterial(MaterialId material) const {
+    return material < m_materials_uploaded ? material : 0;
+  }
+
+  // image holding data, with its copy recorded into cmd_buf from a staging
+  // buffer appended to staging
+  GpuTexture createVkTexture(
+      const TextureData& data, vk::CommandBuffer cmd_buf,
+      std::vector<std::pair<vk::Buffer, vk::DeviceMemory>>& staging) {
+    vk::DeviceSize size = sizeof_vec(data.texels);
+    vk::Buffer buffer_staging;
+    vk::DeviceMemory mem_staging;
+    auto mem_flags_staging = vk::MemoryPropertyFlagBits::eHostVisible
+        | vk::MemoryPropertyFlagBits::eHostCoherent;
+    createVkBuffer(
+        size, vk::BufferUsageFlagBits::eTransferSrc, mem_flags_staging,
+        buffer_staging, mem_staging);
+    staging.push_back({buffer_staging, mem_staging});
+    void* staging_mmap;
+    auto res = m_device.mapMemory(mem_staging, 0, size, {}, &staging_mmap);
+    check(res, "failed to map GPU buffer");
+    memcpy(staging_mmap, data.texels.data(), size);
+    m_device.unmapMemory(mem_staging);
+
+    GpuTexture texture = {};
+    createImage(
+        data.width, data.height, TEXTURE_FORMAT, vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        vk::MemoryPropertyFlagBits::eDeviceLocal, texture.image, texture.mem);
+    copyBufferToImage(cmd_buf, buffer_staging, texture.image, data.width, data.height);
+    texture.view = createImageView(
+        texture.image, TEXTURE_FORMAT, vk::ImageAspectFlagBits::eColor);
+    return texture;
+  }
+
+  // drops the geometry's hold on its streams, freeing those no other
+  // geometry uses
+  void releaseGeometry(const GpuGeometry& gpu) {
+    auto destroy = [&](const GpuStream& stream) {
+      m_device.destroyBuffer(stream.buffer, nullptr);
+      freeVkMemory(stream.mem);
+    };
+    m_vertex_streams.release(gpu.xs_stream, destroy);
+    m_vertex_streams.release(gpu.colors_stream, destroy);
+    m_index_streams.release(gpu.inds_stream, destroy);
+  }
+
+  // wait for the copies queued by createVkDeviceBuffer and release what
+  // they used
+  void finishUploads(
+      std::vector<vk::CommandBuffer>& xfer_cmd_bufs, std::vector<vk::Fence>& xfer_fences,
+      std::vector<std::pair<vk::Buffer, vk::DeviceMemory>>& staging) {
+    if (!xfer_fences.empty()) {
+      auto res = m_device.waitForFences(
+          xfer_fences.size(), xfer_fences.data(), vk::True, TIMEOUT);
+      check(res, "waitForFences");
+    }
+
+    for (auto& cmd_buf : xfer_cmd_bufs) {
+      m_device.freeCommandBuffers(m_cmd_pool, 1, &cmd_buf);
+    }
+    for (auto& fence : xfer_fences) {
+      m_device.destroyFence(fence, nullptr);
+    }
+    for (auto& [buffer, mem] : staging) {
+      m_device.destroyBuffer(buffer, nullptr);
+      freeVkMemory(mem);
+    }
+    xfer_cmd_bufs.clear();
+    xfer_fences.clear();
+    staging.clear();
+  }
+
+  // Device-local memory the CPU can also write (integrated GPUs, CPU
+  // devices, resizable BAR). A small host-visible window into a larger
+  // device heap (plain BAR) is not worth spending on static geometry.
+  bool supportsDirectUpload() {
+    vk::PhysicalDeviceMemoryProperties props;
+    m_phys_device.getMemoryProperties(&props);
+    vk::DeviceSize largest_local_heap = 0;
+    for (uint32_t i = 0; i < props.memoryHeapCount; ++i) {
+      if (props.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+        largest_local_heap = std::max(largest_local_heap, props.memoryHeaps[i].size);
+      }
+    }
+    // the type createVkBuffer would pick for these flags
+    for (uint32_t i = 0; i < props.memoryTypeCount; ++i) {
+      const auto& type = props.memoryTypes[i];
+      if ((type.propertyFlags & DIRECT_UPLOAD_FLAGS) == DIRECT_UPLOAD_FLAGS) {
+        return props.memoryHeaps[type.heapIndex].size * 2 >= largest_local_heap;
+      }
+    }
+    return false;
+  }
+
+  // Device-local buffer holding data. With direct upload the data is
+  // written in place and the buffer stays mapped in mmap; otherwise mmap is
+  // null and the data goes through a staging buffer, which is appended to
+  // staging and must outlive the copy.
+  void createVkDeviceBuffer(
+      const void* data, vk::DeviceSize size, vk::BufferUsageFlags usage,
+      vk::Buffer& buffer, vk::DeviceMemory& mem, void*& mmap,
+      std::vector<std::pair<vk::Buffer, vk::DeviceMemory>>& staging,
+      std::vector<vk::CommandBuffer>& cmd_bufs, std::vector<vk::Fence>& fences) {
+    if (m_direct_upload) {
+      createVkBuffer(size, usage, DIRECT_UPLOAD_FLAGS, buffer, mem);
+      auto res = m_device.mapMemory(mem, 0, size, {}, &mmap);
+      check(res, "failed to map GPU buffer");
+      memcpy(mmap, data, size);
+      // coherent, and visible to commands submitted after this
+      return;
+    }
+    mmap = nullptr;
+
+    auto usage_staging = vk::BufferUsageFlagBits::eTransferSrc;
+    auto mem_flags_staging = vk::MemoryPropertyFlagBits::eHostVisible
+        | vk::MemoryPropertyFlagBits::eHostCoherent;
+    auto mem_flags_dst = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+    vk::Buffer buffer_staging;
+    vk::DeviceMemory mem_staging;
+    createVkBuffer(size, usage_staging, mem_flags_staging, buffer_staging, mem_staging);
+    staging.push_back({buffer_staging, mem_staging});
+
+    void* staging_mmap;
+    auto res = m_device.mapMemory(mem_staging, 0, size, {}, &staging_mmap);
+    check(res, "failed to map GPU buffer");
+    memcpy(staging_mmap, data, size);
+    // no flush required because we requested coherent memory alloc
+    m_device.unmapMemory(mem_staging);
+
+    createVkBuffer(
+        size, usage | vk::BufferUsageFlagBits::eTransferDst, mem_flags_dst, buffer, mem);
+    copyBuffer(buffer_staging, buffer, size, cmd_bufs, fences);
+  }
+
+  void copyBuffer(
+      vk::Buffer src, vk::Buffer dst, vk::DeviceSize size,
+      std::vector<vk::CommandBuffer>& cmd_bufs, std::vector<vk::Fence>& fences) {
+    vk::CommandBuffer cmd_buf = beginUpload();
+    vk::BufferCopy info_copy = {};
+    info_copy.srcOffset = 0;
+    info_copy.dstOffset = 0;
+    info_copy.size = size;
+    cmd_buf.copyBuffer(src, dst, 1, &info_copy);
+    submitUpload(cmd_buf, cmd_bufs, fences);
+  }
+
+  // whole of src into dst, leaving dst ready to sample
+  void copyBufferToImage(
+      vk::CommandBuffer cmd_buf, vk::Buffer src, vk::Image dst, uint32_t width, uint32_t height) {
+    vk::ImageMemoryBarrier barrier = {};
+    barrier.sType = vk::StructureType::eImageMemoryBarrier;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dst;
+    barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    cmd_buf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+        {}, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vk::BufferImageCopy region = {};
+    region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = vk::Extent3D{width, height, 1};
+    cmd_buf.copyBufferToImage(src, dst, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    cmd_buf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+        {}, 0, nullptr, 0, nullptr, 1, &barrier);
+  }
+
+  // one-shot command buffer for an upload, usually finished by submitUpload
+  vk::CommandBuffer beginUpload() {
+    vk::CommandBufferAllocateInfo info = {};
+    info.sType = vk::StructureType::eCommandBufferAllocateInfo;
+    info.level = vk::CommandBufferLevel::ePrimary;
+    info.commandPool = m_cmd_pool;
+    info.commandBufferCount = 1;
+
+    vk::CommandBuffer cmd_buf;
+    auto res = m_device.allocateCommandBuffers(&info, &cmd_buf);
+    check(res, "allocateCommandBuffers");
+
+    vk::CommandBufferBeginInfo info_begin = {};
+    info_begin.sType = vk::StructureType::eCommandBufferBeginInfo;
+    info_begin.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+    res = cmd_buf.begin(&info_begin);
+    check(res, "failed to begin command buffer");
+    return cmd_buf;
+  }
+
+  // submitted with a fence; both are appended for finishUploads
+  void submitUpload(
+      vk::CommandBuffer cmd_buf,
+      std::vector<vk::CommandBuffer>& cmd_bufs, std::vector<vk::Fence>& fences) {
+    cmd_buf.end();
+
+    vk::SubmitInfo info_submit = {};
+    info_submit.sType = vk::StructureType::eSubmitInfo;
+    info_submit.commandBufferCount = 1;
+    info_submit.pCommandBuffers = &cmd_buf;
+
+    vk::FenceCreateInfo info_fence = {};
+    info_fence.sType = vk::StructureType::eFenceCreateInfo;
+    vk::Fence xfer_fence;
+    auto res = m_device.createFence(&info_fence, nullptr, &xfer_fence);
+    check(res, "createFence");
+
+    res = m_graphics_queue.submit(1, &info_submit, xfer_fence);
+    check(res, "failed to submit command buffer");
+
+    // save for later cleanup
+    cmd_bufs.push_back(cmd_buf);
+    fences.push_back(xfer_fence);
+  }
+
+  void createVkCommandBuffers() {
+    vk::CommandBufferAllocateInfo info = {};
+    info.sType = vk::StructureType::eCommandBufferAllocateInfo;
+    info.commandPool = m_cmd_pool;
+    info.level = vk::CommandBufferLevel::ePrimary;
+    info.commandBufferCount = MAX_FRAMES_IN_FLIGHT;
+    m_cmd_buf.resize(MAX_FRAMES_IN_FLIGHT);
+    auto res = m_device.allocateCommandBuffers(&info, m_cmd_buf.data());
+    check(res, "allocateCommandBuffers");
+  }
+
+  // one per swapchain image and frame in flight, since the commands bake in
+  // both the framebuffer and the frame's descriptor set; recorded on first use
+  void createVkStaticCommandBuffers() {
+    vk::CommandBufferAllocateInfo info = {};
+    info.sType = vk::StructureType::eCommandBufferAllocateInfo;
+    info.commandPool = m_cmd_pool;
+    info.level = vk::CommandBufferLevel::ePrimary;
+    info.commandBufferCount = m_swap_images.size() * MAX_FRAMES_IN_FLIGHT;
+    m_static_cmd_bufs.resize(info.commandBufferCount);
+    auto res = m_device.allocateCommandBuffers(&info, m_static_cmd_bufs.data());
+    check(res, "allocateCommandBuffers");
+    // no draw list hashes to this
+    m_static_signatures.assign(m_static_cmd_bufs.size(), 0);
+  }
+
+  // Identifies what the recorded commands depend on besides buffer
+  // contents: the draws in order with their pipeline, geometry, node,
+  // opacity and material, where this frame's cameras are and the render
+  // scale. Tables the material indexes into are updated after bind and so
+  // never invalidate the commands.
+  uint64_t drawSignature() {
+    const auto& nodes = m_meshes.column<MESH_NODE>();
+    const auto& geometries = m_meshes.column<MESH_GEOMETRY>();
+    const auto& states = m_meshes.column<MESH_RENDER_STATE>();
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&](uint64_t v) {
+      hash = (hash ^ v) * 0x100000001b3ull;
+    };
+    for (const auto& item : m_render_queue.items()) {
+      mix(drawPipeline(item.key));
+      mix(geometries[item.index]);
+      mix(nodes[item.index]);
+      uint32_t opacity;
+      memcpy(&opacity, &states[item.index].opacity, sizeof(opacity));
+      mix(opacity);
+      mix(drawMaterial(states[item.index].material));
+    }
+    mix(m_view_offset);
+    mix(sceneExtent().width);
+    mix(sceneExtent().height);
+    // never 0, which marks an unrecorded buffer
+    return hash | 1;
+  }
+
+  void createVkSyncObjects() {
+    vk::SemaphoreCreateInfo info_sem = {};
+    info_sem.sType = vk::StructureType::eSemaphoreCreateInfo;
+    vk::FenceCreateInfo info_fence = {};
+    info_fence.sType = vk::StructureType::eFenceCreateInfo;
+    // fence starts signaled
+    info_fence.flags = vk::FenceCreateFlagBits::eSignaled;
+    m_sem_image_avail.resize(MAX_FRAMES_IN_FLIGHT);
+    m_sem_render_done.resize(MAX_FRAMES_IN_FLIGHT);
+    m_fence_in_flight.resize(MAX_FRAMES_IN_FLIGHT);
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+      auto res = m_device.createSemaphore(&info_sem, nullptr, &m_sem_image_avail[i]);
+      check(res, "createSemaphore");
+      res = m_device.createSemaphore(&info_sem, nullptr, &m_sem_render_done[i]);
+      check(res, "createSemaphore");
+      res = m_device.createFence(&info_fence, nullptr, &m_fence_in_flight[i]);
+      check(res, "createFence");
+    }
+  }
+
+  // one pipeline statistics query per frame in flight, read back once the
+  // frame's fence has signaled
+  void createVkQueryPool() {
+    vk::QueryPoolCreateInfo info = {};
+    info.sType = vk::StructureType::eQueryPoolCreateInfo;
+    info.queryType = vk::QueryType::ePipelineStatistics;
+    info.queryCount = MAX_FRAMES_IN_FLIGHT;
+    info.pipelineStatistics = PIPELINE_STATS;
+    auto res = m_device.createQueryPool(&info, nullptr, &m_stats_pool);
+    check(res, "createQueryPool");
+  }
+
+  void readPipelineStats() {
+    if (!m_stats_written[m_frame]) {
+      return;
+    }
+    auto res = m_device.getQueryPoolResults(
+        m_stats_pool, m_frame, 1, sizeof(m_pipeline_stats), &m_pipeline_stats,
+        sizeof(m_pipeline_stats), vk::QueryResultFlagBits::e64);
+    check(res, "getQueryPoolResults");
+  }
+
+  // Two timestamps per frame in flight bracketing its commands, for the GPU
+  // time the render scale is steered by and runs of a fixed length report.
+  void createVkTimestampPool() {
+    uint32_t family = findQueueFamilies(m_phys_device).graphics_family.value();
+    uint32_t n_families = 0;
+    m_phys_device.getQueueFamilyProperties(&n_families, nullptr);
+    std::vector<vk::QueueFamilyProperties> families(n_families);
+    m_phys_device.getQueueFamilyProperties(&n_families, families.data());
+    uint32_t valid_bits = families[family].timestampValidBits;
+    if (valid_bits == 0) {
+      std::cout << "GPU timestamps not supported, rendering at full resolution"
+                << " and without GPU frame times\n";
+      return;
+    }
+    vk::PhysicalDeviceProperties props;
+    m_phys_device.getProperties(&props);
+    m_timestamp_period = props.limits.timestampPeriod;
+    m_timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+    m_render_scale = RenderScale(m_options.frame_budget_ms, MIN_RENDER_SCALE);
+
+    vk::QueryPoolCreateInfo info = {};
+    info.sType = vk::StructureType::eQueryPoolCreateInfo;
+    info.queryType = vk::QueryType::eTimestamp;
+    info.queryCount = 2 * MAX_FRAMES_IN_FLIGHT;
+    auto res = m_device.createQueryPool(&info, nullptr, &m_time_pool);
+    check(res, "createQueryPool");
+  }
+
+  // steer the render scale by the GPU time of the frame whose fence has
+  // just signaled, and record it
+  void readFrameTime() {
+    if (!m_time_written[m_frame]) {
+      return;
+    }
+    std::array<uint64_t, 2> ticks;
+    auto res = m_device.getQueryPoolResults(
+        m_time_pool, 2 * m_frame, 2, sizeof(ticks), ticks.data(),
+        sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    check(res, "getQueryPoolResults");
+    uint64_t elapsed = (ticks[1] - ticks[0]) & m_timestamp_mask;
+    double gpu_ms = elapsed * m_timestamp_period * 1e-6;
+    m_render_scale.update(gpu_ms);
+    m_report.gpu_ms.add(gpu_ms);
+  }
+
+  void recordCommandBuffer(vk::CommandBuffer& cmd_buf, uint32_t img_index) {
+    // begin cmd buffer
+    {
+      vk::CommandBufferBeginInfo info = {};
+      info.sType = vk::StructureType::eCommandBufferBeginInfo;
+      info.flags = {};
+      info.pInheritanceInfo = nullptr;
+      auto res = cmd_buf.begin(&info);
+      check(res, "failed to start recording commands");
+    }
+
+    if (m_time_pool) {
+      cmd_buf.resetQueryPool(m_time_pool, 2 * m_frame, 2);
+      cmd_buf.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_time_pool, 2 * m_frame);
+      m_time_written[m_frame] = true;
+    }
+
+    m_img_index = img_index;
+    m_graph.bindImage(
+        m_rg_backbuffer, m_swap_images[img_index], m_swap_image_views[img_index]);
+    if (m_options.gpu_transforms) {
+      m_graph.bindBuffer(m_rg_models, m_models_buffer);
+    }
+    if (m_stats_supported) {
+      cmd_buf.resetQueryPool(m_stats_pool, m_frame, 1);
+      m_stats_written[m_frame] = true;
+    }
+    if (m_writer) {
+      // waits only if the writer has fallen READBACK_SLOTS frames behind
+      uint32_t slot = m_writer->acquire();
+      m_frame_slots[m_frame] = slot;
+      m_frame_numbers[m_frame] = m_frame_count;
+      m_frame_extents[m_frame] = m_extent;
+      m_graph.bindBuffer(m_rg_readback, m_readback_buffers[slot]);
+    }
+    m_graph.execute(cmd_buf);
+    if (m_time_pool) {
+      cmd_buf.writeTimestamp(
+          vk::PipelineStageFlagBits::eBottomOfPipe, m_time_pool, 2 * m_frame + 1);
+    }
+
+    cmd_buf.end();
+  }
+
+  // every node's model matrix for the current time
+  void recordTransformPass(vk::CommandBuffer& cmd_buf) {
+    cmd_buf.bindPipeline(vk::PipelineBindPoint::eCompute, m_compute_pipeline);
+    cmd_buf.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute, m_compute_pipeline_layout,
+        0, 1, &m_compute_set, 0, nullptr);
+    TransformPushConstants pc;
+    pc.time = deltatime_seconds(my_clock::now(), m_start);
+    pc.count = m_scene.size();
+    cmd_buf.pushConstants(
+        m_compute_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(pc), &pc);
+    cmd_buf.dispatch((pc.count + TRANSFORM_GROUP_SIZE - 1) / TRANSFORM_GROUP_SIZE, 1, 1);
+  }
+
+  void recordScenePass(vk::CommandBuffer& cmd_buf) {
+    // begin render pass
+    {
+      vk::RenderPassBeginInfo info = {};
+      info.sType = vk::StructureType::eRenderPassBeginInfo;
+      info.renderPass = m_render_pass;
+      info.framebuffer = m_swap_fbs[m_img_index];
+      info.renderArea.offset = vk::Offset2D{0, 0};
+      info.renderArea.extent = sceneExtent();
+      // overdraw adds up from black
+      float bg = m_options.overdraw ? 0.0f : 0.1f;
+      vk::ClearValue clear_color = {{bg, bg, bg, 1.0f}};
+      vk::ClearValue clear_depth = {{1.0f, 0}};
+      std::array<vk::ClearValue, 2> clear_values = {
+        clear_color, clear_depth,
+      };
+      info.clearValueCount = clear_values.size();
+      info.pClearValues = clear_values.data();
+      if (m_stats_supported) {
+        cmd_buf.beginQuery(m_stats_pool, m_frame, {});
+      }
+      cmd_buf.beginRenderPass(&info, vk::SubpassContents::eInline);
+    }
+
+    vk::Viewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)sceneExtent().width;
+    viewport.height = (float)sceneExtent().height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    cmd_buf.setViewport(0, 1, &viewport);
+    vk::Rect2D scissor = {};
+    scissor.offset = vk::Offset2D{0, 0};
+    scissor.extent = sceneExtent();
+    cmd_buf.setScissor(0, 1, &scissor);
+
+    cmd_buf.bindDescriptorSets(
+        vk::PipelineBindPoint::eGraphics, m_pipeline_layout,
+        0, 1, &m_transform_sets[m_frame], 1, &m_view_offset);
+    // bound once; draws only push their material index
+    if (m_options.bindless) {
+      cmd_buf.bindDescriptorSets(
+          vk::PipelineBindPoint::eGraphics, m_pipeline_layout,
+          1, 1, &m_material_set, 0, nullptr);
+    }
+
+    DrawPushConstants pc_draw;
+
+    // emit in key order, skipping binds of state that is already bound
+    m_draw_stats = {};
+    uint32_t bound_pipeline = ~0u;
+    uint32_t bound_geometry = ~0u;
+    // TODO: "bindless" rendering with one large buffer shared across all meshes
+    const auto& nodes = m_meshes.column<MESH_NODE>();
+    const auto& geometries = m_meshes.column<MESH_GEOMETRY>();
+    const auto& states = m_meshes.column<MESH_RENDER_STATE>();
+    for (const auto& item : m_render_queue.items()) {
+      GeometryId geometry = geometries[item.index];
+      const auto& gpu = m_gpu_geometry[geometry];
+      uint32_t pipeline = drawPipeline(item.key);
+      if (pipeline == NO_PIPELINE) {
+        continue;
+      }
+      if (pipeline != bound_pipeline) {
+        cmd_buf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines[pipeline]);
+        bound_pipeline = pipeline;
+        m_draw_stats.pipeline_binds++;
+      }
+      else {
+        m_draw_stats.pipeline_binds_elided++;
+      }
+
+      if (geometry != bound_geometry) {
+        vk::Buffer vert_buffers[] = {
+          m_vertex_streams.buffer(gpu.xs_stream).buffer,
+          m_vertex_streams.buffer(gpu.colors_stream).buffer,
+        };
+        vk::DeviceSize offsets[] = {0, 0};
+
+        const uint32_t off = 0;
+        const uint32_t n_bindings = 2;
+        cmd_buf.bindVertexBuffers(off, n_bindings, vert_buffers, offsets);
+
+        auto idx_type = getIndexType<decltype(GeometryData::inds)::value_type>();
+        cmd_buf.bindIndexBuffer(m_index_streams.buffer(gpu.inds_stream).buffer, 0, idx_type);
+        bound_geometry = geometry;
+        m_draw_stats.geometry_binds++;
+      }
+      else {
+        m_draw_stats.geometry_binds_elided++;
+      }
+
+      pc_draw.opacity = states[item.index].opacity;
+      pc_draw.material = drawMaterial(states[item.index].material);
+      cmd_buf.pushConstants(
+          m_pipeline_layout, DRAW_PUSH_STAGES, 0, sizeof(pc_draw), &pc_draw);
+      m_draw_stats.push_constant_bytes += sizeof(pc_draw);
+
+      const size_t n_inst = 1;
+      const uint32_t n_idx = gpu.index_count;
+      // selects the model matrix
+      const size_t inst_off = nodes[item.index];
+      const size_t idx_off = 0;
+      const size_t idx_shift = 0;
+      cmd_buf.drawIndexed(n_idx, n_inst, idx_off, idx_shift, inst_off);
+      m_draw_stats.draws++;
+      m_draw_stats.triangles += n_idx / 3;
+    }
+
+    cmd_buf.endRenderPass();
+    if (m_stats_supported) {
+      cmd_buf.endQuery(m_stats_pool, m_frame);
+    }
+  }
+
+  // finished frame into this frame's readback slot, tightly packed
+  void recordReadbackPass(vk::CommandBuffer& cmd_buf) {
+    auto buffer = m_readback_buffers[m_frame_slots[m_frame]];
+    vk::BufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+    region.imageOffset = vk::Offset3D{0, 0, 0};
+    region.imageExtent = vk::Extent3D{m_extent.width, m_extent.height, 1};
+    cmd_buf.copyImageToBuffer(
+        m_graph.getImage(m_rg_backbuffer), vk::ImageLayout::eTransferSrcOptimal,
+        buffer, 1, &region);
+
+    // the graph stops at the device; make the copy visible to the host
+    vk::BufferMemoryBarrier barrier = {};
+    barrier.sType = vk::StructureType::eBufferMemoryBarrier;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    cmd_buf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+        0, nullptr, 1, &barrier, 0, nullptr);
+  }
+
+  // each layer of the multiview target into its tile of the backbuffer
+  void recordComposePass(vk::CommandBuffer& cmd_buf) {
+    auto backbuffer = m_graph.getImage(m_rg_backbuffer);
+    auto view_extent = viewExtent();
+    // columns left over when the width does not divide evenly
+    if (view_extent.width * m_options.views != m_extent.width) {
+      vk::ClearColorValue black = {};
+      vk::ImageSubresourceRange range = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+      cmd_buf.clearColorImage(
+          backbuffer, vk::ImageLayout::eTransferDstOptimal, &black, 1, &range);
+      // the clear covers the whole image, so the copy below must land after it
+      vk::ImageMemoryBarrier barrier = {};
+      barrier.sType = vk::StructureType::eImageMemoryBarrier;
+      barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+      barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+      barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+      barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.image = backbuffer;
+      barrier.subresourceRange = range;
+      cmd_buf.pipelineBarrier(
+          vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+          {}, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    auto scene_extent = sceneExtent();
+    if (scene_extent == view_extent) {
+      std::array<vk::ImageCopy, MAX_VIEWS> regions = {};
+      for (uint32_t i = 0; i < m_options.views; ++i) {
+        auto& region = regions[i];
+        region.srcSubresource = {vk::ImageAspectFlagBits::eColor, 0, i, 1};
+        region.srcOffset = vk::Offset3D{0, 0, 0};
+        region.dstSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+        region.dstOffset = vk::Offset3D{(int32_t)(i * view_extent.width), 0, 0};
+        region.extent = vk::Extent3D{view_extent.width, view_extent.height, 1};
+      }
+      cmd_buf.copyImage(
+          m_graph.getImage(m_rg_views), vk::ImageLayout::eTransferSrcOptimal,
+          backbuffer, vk::ImageLayout::eTransferDstOptimal, m_options.views, regions.data());
+      return;
+    }
+    // rendered at a lower resolution: scale up to fill the tile
+    std::array<vk::ImageBlit, MAX_VIEWS> blits = {};
+    for (uint32_t i = 0; i < m_options.views; ++i) {
+      auto& blit = blits[i];
+      blit.srcSubresource = {vk::ImageAspectFlagBits::eColor, 0, i, 1};
+      blit.srcOffsets[0] = vk::Offset3D{0, 0, 0};
+      blit.srcOffsets[1] = vk::Offset3D{
+        (int32_t)scene_extent.width, (int32_t)scene_extent.height, 1};
+      blit.dstSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+      blit.dstOffsets[0] = vk::Offset3D{(int32_t)(i * view_extent.width), 0, 0};
+      blit.dstOffsets[1] = vk::Offset3D{
+        (int32_t)((i + 1) * view_extent.width), (int32_t)view_extent.height, 1};
+    }
+    cmd_buf.blitImage(
+        m_graph.getImage(m_rg_views), vk::ImageLayout::eTransferSrcOptimal,
+        backbuffer, vk::ImageLayout::eTransferDstOptimal, m_options.views, blits.data(),
+        vk::Filter::eLinear);
+  }
+
+  void buildRenderQueue() {
+    m_render_queue.clear();
+    const auto& nodes = m_meshes.column<MESH_NODE>();
+    const auto& geometries = m_meshes.column<MESH_GEOMETRY>();
+    const auto& bounds = m_meshes.column<MESH_BOUNDS>();
+    const auto& states = m_meshes.column<MESH_RENDER_STATE>();
+    for (uint32_t i = 0; i < m_meshes.size(); ++i) {
+      // view-space distance of the bounds center; with GPU transforms the
+      // CPU only knows the rest pose
+      auto center = m_scene.world(nodes[i]) * glm::vec4(bounds[i].center, 1.0f);
+      float dist = -(m_camera.view * center).z;
+      uint32_t material = states[i].material;
+      uint32_t depth = draw_key::depthBucket(dist, CAMERA_NEAR, CAMERA_FAR);
+      uint32_t geometry = geometries[i];
+      uint64_t key = states[i].isTransparent()
+          ? draw_key::encodeTransparent(PIPELINE_TRANSPARENT, geometry, material, depth)
+          : draw_key::encodeOpaque(PIPELINE_OPAQUE, geometry, material, depth);
+      m_render_queue.push(key, i);
+    }
+    m_render_queue.sort();
+  }
+
+  vk::ShaderModule createShaderModule(const std::vector<char>& code) {
+    vk::ShaderModuleCreateInfo info = {};
+    info.sType = vk::StructureType::eShaderModuleCreateInfo;
+    info.codeSize = code.size();
+    info.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    vk::ShaderModule mod;
+    auto res = m_device.createShaderModule(&info, nullptr, &mod);
+    check(res, "createShaderModule");
+    return mod;
+  }
+
+  bool isDeviceSuitable(const vk::PhysicalDevice& device) {
+    if (!findQueueFamilies(device).allAvailable()) {
+      return false;
+    }
+    if (!checkDeviceExtensionSupport(device)) {
+      return false;
+    }
+    if (!m_options.headless && !querySwapChainSupportKHR(device).isAcceptable()) {
+      return false;
+    }
+    // --views cameras in one multiview pass
+    if (m_options.views > 1 && !supportsMultiview(device)) {
+      return false;
+    }
+    // MAX_TEXTURES textures indexed and updated after bind
+    if (m_options.bindless && !supportsDescriptorIndexing(device)) {
+      return false;
+    }
+    return true;
+  }
+
+  // the swapchain is only needed with a window
+  std::vector<const char*> deviceExtensions() const {
+    std::vector<const char*> extensions;
+    if (!m_options.headless) {
+      extensions = g_device_extensions;
+    }
+    if (m_options.bindless) {
+      extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
+    return extensions;
+  }
+
+  bool checkDeviceExtensionSupport(const vk::PhysicalDevice& device) {
+    auto supported = supportedExtensions(device);
+    for (const char* extension : deviceExtensions()) {
+      if (!supported.count(extension)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::set<std::string> supportedExtensions(const vk::PhysicalDevice& device) {
+    uint32_t n_extension;
+    auto res = device.enumerateDeviceExtensionProperties(nullptr, &n_extension, nullptr);
+    check(res, "");
+    std::vector<vk::ExtensionProperties> extensions(n_extension);
+    res = device.enumerateDeviceExtensionProperties(nullptr, &n_extension, extensions.data());
+    check(res, "");
+    std::set<std::string> names;
+    for (const auto& extension : extensions) {
+      names.insert(extension.extensionName);
+    }
+    return names;
+  }
+
+  QueueFamilyIndices findQueueFamilies(const vk::PhysicalDevice& device) {
+    QueueFamilyIndices indices = {};
+    uint32_t  n_queue_families = 0;
+    device.getQueueFamilyProperties(&n_queue_families, nullptr);
+    std::vector<vk::QueueFamilyProperties> queue_families(n_queue_families);
+    device.getQueueFamilyProperties(&n_queue_families, queue_families.data());
+    for (int i = 0; i < (int)queue_families.size(); ++i) {
+      if (indices.allAvailable()) {
+        break;
+      }
+      // queue for graphics commands
+      if (queue_families[i].queueFlags & vk::QueueFlagBits::eGraphics) {
+        indices.graphics_family = i;
+      }
+      // queue for present commands; headless never presents
+      if (m_options.headless) {
+        indices.present_family = indices.graphics_family;
+        continue;
+      }
+      VkBool32 present_support = false;
+      auto ret = device.getSurfaceSupportKHR(i, m_surface, &present_support);
+      if (ret != vk::Result::eSuccess) {
+        throw std::runtime_error("");
+      }
+      if (present_support) {
+        indices.present_family = i;
+      }
+    }
+    return indices;
+  }
+
+  uint32_t findMemoryType(uint32_t type_filter, vk::MemoryPropertyFlags flags) {
+    vk::PhysicalDeviceMemoryProperties props;
+    m_phys_device.getMemoryProperties(&props);
+    return ::findMemoryType(props, type_filter, flags);
+  }
+
+  SwapChainSupportDetails querySwapChainSupportKHR(const vk::PhysicalDevice& device) {
+    SwapChainSupportDetails details;
+    // capabilities
+    auto res = device.getSurfaceCapabilitiesKHR(m_surface, &details.caps);
+    check(res, "getSurfaceCapabilitiesKHR");
+    // formats
+    uint32_t n_format;
+    res = device.getSurfaceFormatsKHR(m_surface, &n_format, nullptr);
+    check(res, "getSurfaceFormatsKHR");
+    details.formats.resize(n_format);
+    res = device.getSurfaceFormatsKHR(m_surface, &n_format, details.formats.data());
+    check(res, "getSurfaceFormatsKHR");
+    // present modes
+    uint32_t n_modes;
+    res = device.getSurfacePresentModesKHR(m_surface, &n_modes, nullptr);
+    check(res, "getSurfacePresentModesKHR");
+    details.modes.resize(n_modes);
+    res = device.getSurfacePresentModesKHR(m_surface, &n_modes, details.modes.data());
+    check(res, "getSurfacePresentModesKHR");
+    return details;
+  }
+
+  vk::SurfaceFormatKHR selectSwapSurfaceFormatKHR(const std::vector<vk::SurfaceFormatKHR>& formats) {
+    // try for BGRA8888 sRGB, otherwise select the first format
+    for (const auto& format : formats) {
+      if (format.format == vk::Format::eB8G8R8A8Srgb &&
+          format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
+        return format;
+      }
+    }
+    return formats[0];
+  }
+
+  vk::PresentModeKHR selectSwapPresentModeKHR(const std::vector<vk::PresentModeKHR>& modes) {
+    // FORNOW: prefer immediate, as this is the only sensible mode on X11 + nvidia
+    for (const auto& mode : modes) {
+      if (mode == vk::PresentModeKHR::eImmediate) {
+        return mode;
+      }
+    }
+    return modes[0];
+  }
+
+  vk::Extent2D selectSwapExtentKHR(const vk::SurfaceCapabilitiesKHR& caps) {
+    // extent set by Vulkan itself
+    if (caps.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
+      return caps.currentExtent;
+    }
+    // manually set extent to match window size in pixels
+    vk::Extent2D extent = framebufferExtent();
+    uint32_t min_width = caps.minImageExtent.width;
+    uint32_t min_height = caps.minImageExtent.height;
+    uint32_t max_width = caps.maxImageExtent.width;
+    uint32_t max_height = caps.maxImageExtent.height;
+    extent.width = std::clamp(extent.width, min_width, max_width);
+    extent.height = std::clamp(extent.height, min_height, max_height);
+    return extent;
+  }
+
+  bool checkValidationLayerSupport() {
+    uint32_t n_layer;
+    auto res = vk::enumerateInstanceLayerProperties(&n_layer, nullptr);
+    check(res, "enumerateInstanceLayerProperties");
+    std::vector<vk::LayerProperties> layers(n_layer);
+    res = vk::enumerateInstanceLayerProperties(&n_layer, layers.data());
+    check(res, "enumerateInstanceLayerProperties");
+
+    for (const char* layer : g_validation_layers) {
+      bool found = false;
+      for (const auto& layer_props : layers) {
+        if (strcmp(layer, layer_props.layerName) == 0) {
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        std::cerr << "Missing validation layer " << layer << "\n";
+        return false;
+      }
+    }
+    std::cout << "All validation layers found.\n";
+    return true;
+  }
+
+  // Headless, frames are rendered right here. With a window this thread
+  // only pumps GLFW events (which must happen on the main thread) into
+  // m_events, and frames are rendered on a thread of their own: slow
+  // presents and fence waits do not hold up input, and dragging or
+  // resizing the window does not stall frames.
+  void mainLoop() {
+    if (m_options.headless) {
+      renderLoop();
+      return;
+    }
+    std::exception_ptr error;
+    std::atomic<bool> render_done = false;
+    std::thread render_thread([&]() {
+      try {
+        renderLoop();
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+      render_done.store(true);
+      glfwPostEmptyEvent();
+    });
+    while (!render_done.load()) {
+      glfwWaitEvents();
+    }
+    render_thread.join();
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  void renderLoop() {
+    m_framerate.init();
+    m_report.cpu_ms.reserve(m_options.frames);
+    m_report.gpu_ms.reserve(m_options.frames);
+    auto loop_start = my_clock::now();
+    if (!m_replay) {
+      updateGame();
+    }
+    while (running()) {
+      auto frame_start = my_clock::now();
+      uint64_t allocs = alloc_counter::count();
+      if (!m_options.headless) {
+        pollWindowEvents();
+      }
+      // this frame was simulated while the previous one was submitted
+      m_jobs.wait(m_sim_done);
+      if (m_replay) {
+        replayFrame();
+      }
+      bool acquired = prepareFrame();
+      // simulate the next frame on the workers while recording this one;
+      // recording only reads the render queue built by prepareFrame
+      if (!m_replay) {
+        auto simulate = [](void* data, uint32_t, uint32_t) {
+          static_cast<Application*>(data)->updateGame();
+        };
+        m_jobs.submit(simulate, this, 0, 1, &m_sim_done);
+      }
+      if (acquired) {
+        submitFrame();
+        m_total_draws += m_draw_stats.draws;
+      }
+      checkFrameAllocs(alloc_counter::count() - allocs);
+      if (m_options.frames > 0) {
+        m_report.peak_device_bytes =
+            std::max(m_report.peak_device_bytes, deviceMemoryInUse());
+      }
+      m_report.cpu_ms.add(deltatime_seconds(my_clock::now(), frame_start) * 1000.0);
+      if (m_framerate.tick()) {
+        std::cout << "Draws: " << m_draw_stats.draws
+                  << ", pipeline binds: " << m_draw_stats.pipeline_binds
+                  << " (" << m_draw_stats.pipeline_binds_elided << " elided)"
+                  << ", geometry binds: " << m_draw_stats.geometry_binds
+                  << " (" << m_draw_stats.geometry_binds_elided << " elided)"
+                  << ", transforms uploaded: " << m_transforms_uploaded
+                  << ", heap allocations: " << m_frame_allocs;
+        if (m_options.prerecord) {
+          std::cout << ", re-recorded: " << m_rerecords;
+          m_rerecords = 0;
+        }
+        if (m_time_pool && m_options.frame_budget_ms > 0.0) {
+          std::cout << ", render scale: " << (int)(100.0f * m_render_scale.scale())
+                    << "% at " << m_render_scale.averageMs() << " ms GPU";
+        }
+        std::cout << "\n";
+        if (m_options.stats) {
+          printFrameStats();
+        }
+        m_transforms_uploaded = 0;
+        m_frame_allocs = 0;
+      }
+    }
+    m_jobs.wait(m_sim_done);
+    m_device.waitIdle();
+    if (m_writer) {
+      // oldest first
+      for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        collectReadback((m_frame + i) % MAX_FRAMES_IN_FLIGHT);
+      }
+      m_writer->finish();
+      std::cout << "Exported " << m_writer->written() << " frames to "
+                << m_options.export_target << "\n";
+    }
+
+    m_report.frames = m_frame_count;
+    m_report.seconds = deltatime_seconds(my_clock::now(), loop_start);
+    m_report.meshes = m_meshes.size();
+    m_report.geometries = m_gpu_geometry.size();
+    m_report.streams = m_vertex_streams.size() + m_index_streams.size();
+    m_report.draws = m_draw_stats.draws;
+    m_report.triangles = m_draw_stats.triangles;
+    if (m_options.headless) {
+      double dt = m_report.seconds;
+      auto flags = std::cout.flags();
+      std::cout.precision(2);
+      std::cout << std::fixed << "Rendered " << m_frame_count << " frames in " << dt << " s: "
+                << m_frame_count / dt << " frames/s, "
+                << 1000.0 * dt / std::max<uint64_t>(m_frame_count, 1) << " ms/frame, "
+                << m_total_draws / dt << " draws/s\n";
+      std::cout.flags(flags);
+    }
+    if (m_capture) {
+      std::cout << "Captured " << m_capture->frames() << " frames to "
+                << m_options.capture << "\n";
+    }
+  }
+
+  // counters of the last recorded frame, and the GPU statistics of the last
+  // completed one
+  void printFrameStats() {
+    std::cout << "  submitted: " << m_draw_stats.triangles << " triangles, "
+              << m_draw_stats.geometry_binds << " vertex/index binds, "
+              << m_draw_stats.push_constant_bytes << " push constant bytes, "
+              << m_frame_alloc.used() << "/" << m_frame_alloc.regionSize()
+              << " frame arena bytes\n";
+    if (m_stats_supported) {
+      const auto& s = m_pipeline_stats;
+      std::cout << "  gpu: " << s.ia_primitives << " primitives assembled, "
+                << s.vs_invocations << " vertex invocations, "
+                << s.clip_primitives << "/" << s.clip_invocations << " primitives past clipping, "
+                << s.fs_invocations << " fragment invocations\n";
+    }
+  }
+
+  // once warmed up (again, after a swapchain recreation) a frame should not
+  // touch the heap
+  void checkFrameAllocs(uint64_t allocs) {
+    m_frame_allocs += allocs;
+    if (m_frame_count > m_alloc_check_from) {
+      m_report.heap_allocations += allocs;
+    }
+    if (m_options.assert_no_alloc && allocs != 0 && m_frame_count > m_alloc_check_from) {
+      throw std::runtime_error(
+          std::to_string(allocs) + " heap allocations in frame " + std::to_string(m_frame_count));
+    }
+  }
+
+  bool running() {
+    if (m_options.frames != 0 && m_frame_count >= m_options.frames) {
+      return false;
+    }
+    return m_options.headless || !m_close_requested.load();
+  }
+
+  // render thread only, not from simulation jobs: depends on the swapchain
+  // extent, which the render thread recreates
+  void updateCamera() {
+    auto proj_aspect = viewExtent().width / (float) viewExtent().height;
+    auto proj_near = CAMERA_NEAR;
+    auto proj_far = CAMERA_FAR;
+
+    // perspective
+    auto proj_fovy = glm::radians(45.0f);
+    m_camera.proj = glm::perspective(proj_fovy, proj_aspect, proj_near, proj_far);
+    m_camera.proj[1][1] *= -1; // flip opengl -> vk conventions
+
+    // orthographic
+    // auto proj_left = -proj_aspect;
+    // auto proj_right = proj_aspect;
+    // auto proj_top = 2.0f;
+    // auto proj_bottom = -2.0f;
+    // m_camera.proj = glm::ortho(proj_left, proj_right, proj_top, proj_bottom, proj_near, proj_far);
+  }
+
+  // runs as a job, overlapped with recording of the previous frame; touches
+  // only the scene graph and the pending transform uploads
+  void updateGame() {
+    // animated by the transform pass instead
+    if (m_options.gpu_transforms) {
+      return;
+    }
+    float time = deltatime_seconds(my_clock::now(), m_start);
+
+    const auto& nodes = m_meshes.column<MESH_NODE>();
+    const auto& animations = m_meshes.column<MESH_ANIMATION>();
+    for (uint32_t i = 0; i < m_meshes.size(); ++i) {
+      const auto& anim = animations[i];
+      if (anim.spin_rate != 0.0f) {
+        auto theta = time * anim.spin_rate;
+        m_scene.setRotation(nodes[i], glm::angleAxis(theta, anim.spin_axis));
+      }
+    }
+    updateScene();
+  }
+
+  // propagate transforms and queue the changed matrices for upload into
+  // every frame's buffer
+  void updateScene() {
+    m_scene.update(&m_jobs);
+    const auto& changed = m_scene.changedRanges();
+    // nothing to upload when the GPU computes the matrices
+    if (!m_options.gpu_transforms) {
+      for (auto& pending : m_transform_pending) {
+        pending.insert(pending.end(), changed.begin(), changed.end());
+      }
+    }
+    if (!m_options.capture.empty()) {
+      m_capture_ranges.insert(m_capture_ranges.end(), changed.begin(), changed.end());
+    }
+  }
+
+  // stands in for updateGame and buildRenderQueue when replaying; wraps
+  // around if more frames are requested than were captured
+  void replayFrame() {
+    const auto& frames = m_replay->frames();
+    const auto& frame = frames[m_replay_frame++ % frames.size()];
+    m_camera.view = frame.view;
+    m_camera.proj = frame.proj;
+    const glm::mat4* transforms = frame.transforms.data();
+    for (const auto& range : frame.ranges) {
+      m_scene.setWorld(range, transforms);
+      transforms += range.count;
+    }
+    for (auto& pending : m_transform_pending) {
+      pending.insert(pending.end(), frame.ranges.begin(), frame.ranges.end());
+    }
+    // sorted when captured
+    m_render_queue.clear();
+    for (const auto& draw : frame.draws) {
+      m_render_queue.push(draw.key, draw.index);
+    }
+  }
+
+  // what prepareFrame handed to the renderer, plus the transforms that
+  // changed since the last captured frame
+  void captureFrame() {
+    m_capture->writeFrame(
+        m_camera.view, m_camera.proj, m_capture_ranges, m_scene.worldData(),
+        m_render_queue.items());
+    m_capture_ranges.clear();
+  }
+
+  // Everything that reads the simulated scene: upload changed transforms
+  // and build the sorted draw list. Returns false if no image was acquired.
+  bool prepareFrame() {
+    // sync
+    auto res = m_device.waitForFences(1, &m_fence_in_flight[m_frame], vk::True, TIMEOUT);
+    check(res, "waitForFences");
+    destroyRetiredSwapchains(false);
+    if (m_stats_supported) {
+      readPipelineStats();
+    }
+    if (m_time_pool) {
+      readFrameTime();
+    }
+    if (m_writer) {
+      collectReadback(m_frame);
+    }
+    m_frame_alloc.reset(m_frame);
+    finishVkPipelines(false);
+    uploadTransforms();
+    if (m_options.bindless) {
+      // once, even if this frame is retried after a swapchain recreation
+      if (!m_replay && m_options.stress_meshes == 0 && m_frame_count == LATE_MATERIAL_FRAME
+          && m_meshes.get<MESH_RENDER_STATE>(m_late_material_mesh).material == 0) {
+        addLateMaterial();
+      }
+      streamMaterials();
+    }
+
+    // get swap chain index
+    if (m_options.headless) {
+      m_img_index = m_frame;
+    }
+    else {
+      constexpr auto no_fence = VK_NULL_HANDLE;
+      res = m_device.acquireNextImageKHR(
+          m_swapchain, TIMEOUT, m_sem_image_avail[m_frame], no_fence, &m_img_index);
+      if (res == vk::Result::eErrorOutOfDateKHR) {
+        recreateVkSwapchain();
+        return false;
+      }
+      check(res, "acquireNextImageKHR");
+    }
+
+    if (!m_replay) {
+      updateCamera();
+      buildRenderQueue();
+    }
+    uploadViews();
+    if (m_capture) {
+      captureFrame();
+    }
+    return true;
+  }
+
+  // record, submit and present; safe to overlap with updateGame
+  void submitFrame() {
+    constexpr vk::CommandBufferResetFlags flags = {};
+    vk::CommandBuffer* cmd_buf = &m_cmd_buf[m_frame];
+    if (m_options.prerecord) {
+      // only this frame in flight submits it, and its fence has signaled
+      uint32_t slot = m_img_index * MAX_FRAMES_IN_FLIGHT + m_frame;
+      cmd_buf = &m_static_cmd_bufs[slot];
+      uint64_t signature = drawSignature();
+      if (m_static_signatures[slot] != signature) {
+        cmd_buf->reset(flags);
+        recordCommandBuffer(*cmd_buf, m_img_index);
+        m_static_signatures[slot] = signature;
+        m_rerecords++;
+      }
+    }
+    else {
+      cmd_buf->reset(flags);
+      recordCommandBuffer(*cmd_buf, m_img_index);
+    }
+
+    // submit command buf
+    vk::SubmitInfo info = {};
+    info.sType = vk::StructureType::eSubmitInfo;
+
+    vk::PipelineStageFlags stage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    // offscreen images are neither acquired nor presented
+    if (!m_options.headless) {
+      info.waitSemaphoreCount = 1;
+      info.pWaitSemaphores = &m_sem_image_avail[m_frame];
+      info.pWaitDstStageMask = &stage;
+      info.signalSemaphoreCount = 1;
+      info.pSignalSemaphores = &m_sem_render_done[m_frame];
+    }
+    info.commandBufferCount = 1;
+    info.pCommandBuffers = cmd_buf;
+
+    auto res = m_device.resetFences(1, &m_fence_in_flight[m_frame]);
+    check(res, "resetFences");
+    res = m_graphics_queue.submit(1, &info, m_fence_in_flight[m_frame]);
+    check(res, "failed to submit draw command buffer");
+    m_frame_count++;
+
+    if (!m_options.headless) {
+      presentFrame();
+    }
+
+    // advance frame
+    m_frame = (m_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+  }
+
+  void presentFrame() {
+    vk::PresentInfoKHR info_present = {};
+    info_present.sType = vk::StructureType::ePresentInfoKHR;
+    info_present.waitSemaphoreCount = 1;
+    info_present.pWaitSemaphores = &m_sem_render_done[m_frame];
+    info_present.swapchainCount = 1;
+    info_present.pSwapchains = &m_swapchain;
+    info_present.pImageIndices = &m_img_index;
+
+    auto res = m_present_queue.presentKHR(&info_present);
+    if (res == vk::Result::eErrorOutOfDateKHR ||
+        res == vk::Result::eSuboptimalKHR ||
+        m_fb_resized) {
+      m_fb_resized = false;
+      recreateVkSwapchain();
+    }
+    else {
+      check(res, "failed to present frame");
+    }
+  }
+
+  void cleanupVkSwapchain() {
+    destroyRetiredSwapchains(true);
+    m_graph.destroy(m_device);
+    for (auto fb : m_swap_fbs) {
+      m_device.destroyFramebuffer(fb, nullptr);
+    }
+    for (auto image_view : m_swap_image_views) {
+      m_device.destroyImageView(image_view, nullptr);
+    }
+    if (m_options.headless) {
+      for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        m_device.destroyImage(m_swap_images[i], nullptr);
+        freeVkMemory(m_offscreen_mems[i]);
+      }
+    }
+    else {
+      m_device.destroySwapchainKHR(m_swapchain, nullptr);
+    }
+  }
+
+  void cleanupVkVertexBuffers() {
+    for (const auto& gpu : m_gpu_geometry) {
+      releaseGeometry(gpu);
+    }
+    m_gpu_geometry.clear();
+  }
+
+  void cleanupVkMaterials() {
+    retireTextureUploads(true);
+    for (const auto& texture : m_textures) {
+      m_device.destroyImageView(texture.view, nullptr);
+      m_device.destroyImage(texture.image, nullptr);
+      freeVkMemory(texture.mem);
+    }
+    m_textures.clear();
+    m_device.destroySampler(m_sampler, nullptr);
+    m_device.unmapMemory(m_material_mem);
+    m_device.destroyBuffer(m_material_buffer, nullptr);
+    freeVkMemory(m_material_mem);
+    m_device.destroyDescriptorPool(m_material_pool, nullptr);
+  }
+
+  void cleanup() {
+    cleanupVkSwapchain();
+    cleanupVkVertexBuffers();
+    if (m_options.gpu_transforms) {
+      m_device.destroyBuffer(m_animations_buffer, nullptr);
+      freeVkMemory(m_animations_mem);
+      m_device.destroyBuffer(m_models_buffer, nullptr);
+      freeVkMemory(m_models_mem);
+      m_device.destroyPipeline(m_compute_pipeline, nullptr);
+      m_device.destroyPipelineLayout(m_compute_pipeline_layout, nullptr);
+      m_device.destroyDescriptorSetLayout(m_compute_set_layout, nullptr);
+    }
+    else {
+      for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        m_device.unmapMemory(m_transform_mems[i]);
+        m_device.destroyBuffer(m_transform_buffers[i], nullptr);
+        freeVkMemory(m_transform_mems[i]);
+      }
+    }
+    m_device.unmapMemory(m_frame_mem);
+    m_device.destroyBuffer(m_frame_buffer, nullptr);
+    freeVkMemory(m_frame_mem);
+    if (m_writer) {
+      for (uint32_t i = 0; i < READBACK_SLOTS; ++i) {
+        m_device.unmapMemory(m_readback_mems[i]);
+        m_device.destroyBuffer(m_readback_buffers[i], nullptr);
+        freeVkMemory(m_readback_mems[i]);
+      }
+    }
+    m_device.destroyDescriptorPool(m_descriptor_pool, nullptr);
+    if (m_options.bindless) {
+      cleanupVkMaterials();
+    }
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+      m_device.destroySemaphore(m_sem_image_avail[i], nullptr);
+      m_device.destroySemaphore(m_sem_render_done[i], nullptr);
+      m_device.destroyFence(m_fence_in_flight[i], nullptr);
+    }
+    if (m_stats_supported) {
+      m_device.destroyQueryPool(m_stats_pool, nullptr);
+    }
+    if (m_time_pool) {
+      m_device.destroyQueryPool(m_time_pool, nullptr);
+    }
+    m_device.destroyCommandPool(m_cmd_pool, nullptr);
+    finishVkPipelines(true);
+    for (auto pipeline : m_pipelines) {
+      m_device.destroyPipeline(pipeline, nullptr);
+    }
+    m_device.destroyPipelineCache(m_pipeline_cache, nullptr);
+    m_device.destroyPipelineLayout(m_pipeline_layout, nullptr);
+    m_device.destroyDescriptorSetLayout(m_transform_set_layout, nullptr);
+    if (m_options.bindless) {
+      m_device.destroyDescriptorSetLayout(m_material_set_layout, nullptr);
+    }
+    m_device.destroyRenderPass(m_render_pass, nullptr);
+    m_device.destroy(nullptr);
+    if (!m_options.headless) {
+      m_instance.destroySurfaceKHR(m_surface, nullptr);
+    }
+    m_instance.destroy(nullptr);
+    if (!m_options.headless) {
+      glfwDestroyWindow(m_window);
+      glfwTerminate();
+    }
+  }
+
+  Options m_options;
+  // workers; they keep running until it is destroyed, after everything
+  // declared below, so ~Application first waits for outstanding jobs
+  JobSystem m_jobs;
+  // simulation of the next frame
+  JobCounter m_sim_done;
+  // glfw stuff
+  GLFWwindow* m_window = nullptr;
+  // written by the event thread, read by the render thread
+  SpscQueue<WindowEvent, WINDOW_EVENT_CAPACITY> m_events;
+  std::atomic<uint64_t> m_fb_size = 0;
+  std::atomic<bool> m_close_requested = false;
+  // vulkan stuff
+  vk::Queue m_graphics_queue;
+  vk::Queue m_present_queue;
+  vk::Instance m_instance;
+  vk::PhysicalDevice m_phys_device = VK_NULL_HANDLE;
+  vk::Device m_device;
+  // swapchain
+  std::vector<vk::Image> m_swap_images;
+  std::vector<vk::ImageView> m_swap_image_views;
+  std::vector<vk::Framebuffer> m_swap_fbs;
+  vk::SwapchainKHR m_swapchain;
+  std::deque<RetiredSwapchain> m_retired;
+  // swapchain image stand-ins when headless
+  std::vector<vk::DeviceMemory> m_offscreen_mems;
+  // surface properties
+  VkSurfaceKHR m_surface;
+  vk::SurfaceFormatKHR m_format;
+  vk::PresentModeKHR m_present_mode;
+  vk::Extent2D m_extent;
+  // pipeline
+  ShaderArchive m_shaders{_binary_shaders_pak_start, _binary_shaders_pak_end};
+  vk::DescriptorSetLayout m_transform_set_layout;
+  // bindless tables, with --bindless
+  vk::DescriptorSetLayout m_material_set_layout;
+  vk::PipelineLayout m_pipeline_layout;
+  vk::RenderPass m_render_pass;
+  std::array<vk::Pipeline, PIPELINE_COUNT> m_pipelines;
+  // set once a worker has compiled the pipeline; m_pipeline_build lives
+  // until all are
+  std::array<std::atomic<bool>, PIPELINE_COUNT> m_pipeline_ready;
+  // see PipelineDesc::fallback
+  std::array<uint32_t, PIPELINE_COUNT> m_pipeline_fallbacks;
+  vk::PipelineCache m_pipeline_cache;
+  std::unique_ptr<PipelineBuild> m_pipeline_build;
+  // drawing
+  vk::CommandPool m_cmd_pool;
+  std::vector<vk::CommandBuffer> m_cmd_buf;
+  // --prerecord: indexed by image * MAX_FRAMES_IN_FLIGHT + frame, with the
+  // draw signature each was recorded for
+  std::vector<vk::CommandBuffer> m_static_cmd_bufs;
+  std::vector<uint64_t> m_static_signatures;
+  uint64_t m_rerecords = 0;
+  uint32_t m_frame = 0;
+  // total frames submitted, for retiring resources
+  uint64_t m_frame_count = 0;
+  uint32_t m_img_index = 0;
+  bool m_fb_resized = false;
+  // model matrices
+  vk::DescriptorPool m_descriptor_pool;
+  std::array<vk::DescriptorSet, MAX_FRAMES_IN_FLIGHT> m_transform_sets;
+  std::array<vk::Buffer, MAX_FRAMES_IN_FLIGHT> m_transform_buffers;
+  std::array<vk::DeviceMemory, MAX_FRAMES_IN_FLIGHT> m_transform_mems;
+  std::array<glm::mat4*, MAX_FRAMES_IN_FLIGHT> m_transform_mmaps;
+  // node ranges each frame's buffer is missing
+  std::array<std::vector<NodeRange>, MAX_FRAMES_IN_FLIGHT> m_transform_pending;
+  uint64_t m_transforms_uploaded = 0;
+  // transient per-frame data, reset when the frame's fence signals
+  vk::Buffer m_frame_buffer;
+  vk::DeviceMemory m_frame_mem;
+  FrameAllocator m_frame_alloc;
+  uint32_t m_frame_align = 1;
+  // this frame's cameras in m_frame_buffer
+  uint32_t m_view_offset = 0;
+  // GPU transforms: animation inputs and the matrices computed from them
+  vk::DescriptorSetLayout m_compute_set_layout;
+  vk::PipelineLayout m_compute_pipeline_layout;
+  vk::Pipeline m_compute_pipeline;
+  vk::DescriptorSet m_compute_set;
+  vk::Buffer m_animations_buffer;
+  vk::DeviceMemory m_animations_mem;
+  void* m_animations_mmap = nullptr;
+  vk::Buffer m_models_buffer;
+  vk::DeviceMemory m_models_mem;
+  // frame graph
+  RenderGraph m_graph;
+  RenderGraph::Resource m_rg_backbuffer;
+  RenderGraph::Resource m_rg_depth;
+  RenderGraph::Resource m_rg_models;
+  // layered color target of the multiview pass
+  RenderGraph::Resource m_rg_views;
+  RenderGraph::Resource m_rg_readback;
+  // sync
+  std::vector<vk::Semaphore> m_sem_image_avail;
+  std::vector<vk::Semaphore> m_sem_render_done;
+  std::vector<vk::Fence> m_fence_in_flight;
+  // game data
+  MeshStore m_meshes;
+  std::vector<GeometryData> m_geometry_data;
+  std::vector<GpuGeometry> m_gpu_geometry;
+  // content-hashed; index and vertex buffers differ in usage so are kept apart
+  StreamCache<GpuStream> m_vertex_streams;
+  StreamCache<GpuStream> m_index_streams;
+  // geometry is written straight into device-local memory
+  bool m_direct_upload = false;
+  std::vector<TextureData> m_texture_data;
+  std::vector<GpuMaterial> m_material_data;
+  // prefixes of the above already in the bindless tables
+  std::vector<GpuTexture> m_textures;
+  uint32_t m_materials_uploaded = 0;
+  // textures whose upload has finished and whose table slot is written
+  uint32_t m_textures_bound = 0;
+  std::deque<TextureUpload> m_texture_uploads;
+  // switches to a material added mid-run, see addLateMaterial
+  Entity m_late_material_mesh;
+  vk::Sampler m_sampler;
+  vk::Buffer m_material_buffer;
+  vk::DeviceMemory m_material_mem;
+  GpuMaterial* m_material_mmap = nullptr;
+  vk::DescriptorPool m_material_pool;
+  vk::DescriptorSet m_material_set;
+  SceneGraph m_scene;
+  my_time m_start;
+  Camera m_camera;
+  RenderQueue m_render_queue;
+  DrawStats m_draw_stats;
+  uint64_t m_total_draws = 0;
+  RunReport m_report;
+  // sizes of what createVkBuffer and createImage allocated, for
+  // deviceMemoryInUse without VK_EXT_memory_budget
+  std::unordered_map<VkDeviceMemory, vk::DeviceSize> m_device_allocs;
+  uint64_t m_device_live_bytes = 0;
+  bool m_memory_budget = false;
+  // heap allocations in frames since the last stats report
+  uint64_t m_frame_allocs = 0;
+  uint64_t m_alloc_check_from = ALLOC_WARMUP_FRAMES;
+  // capture and replay
+  std::unique_ptr<capture::Writer> m_capture;
+  // transforms changed since the last captured frame
+  std::vector<NodeRange> m_capture_ranges;
+  std::unique_ptr<capture::Reader> m_replay;
+  uint64_t m_replay_frame = 0;
+  // export: readback slots, and the slot each frame in flight copies into
+  std::unique_ptr<FrameWriter> m_writer;
+  std::array<vk::Buffer, READBACK_SLOTS> m_readback_buffers;
+  std::array<vk::DeviceMemory, READBACK_SLOTS> m_readback_mems;
+  bool m_readback_coherent = true;
+  vk::Extent2D m_readback_extent;
+  std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> m_frame_slots;
+  std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_frame_numbers;
+  std::array<vk::Extent2D, MAX_FRAMES_IN_FLIGHT> m_frame_extents;
+  // debugging
+  Framerate m_framerate;
+  bool m_stats_supported = false;
+  vk::QueryPool m_stats_pool;
+  // the frame's query has been recorded at least once
+  std::array<bool, MAX_FRAMES_IN_FLIGHT> m_stats_written = {};
+  PipelineStats m_pipeline_stats = {};
+  // dynamic resolution, see RenderScale
+  RenderScale m_render_scale;
+  vk::QueryPool m_time_pool;
+  // nanoseconds per timestamp tick, and the bits of a timestamp that count
+  double m_timestamp_period = 0.0;
+  uint64_t m_timestamp_mask = 0;
+  std::array<bool, MAX_FRAMES_IN_FLIGHT> m_time_written = {};
+};
@@ -0,0 +1,91 @@
+#include <sys/resource.h>
+
+#include <fstream>
+
+#include "application.h"
+
+// Renders a generated stress scene headless for a fixed number of frames
+// and writes what the run measured to a JSON report. The scene is set up
+// with the --stress options; run once per configuration to plot how the
+// renderer scales.
+
+constexpr uint32_t DEFAULT_MESHES = 1000;
+constexpr uint64_t DEFAULT_FRAMES = 300;
+
+static void writeTimes(std::ostream& out, const char* name, const FrameTimes& times) {
+  auto s = times.summary();
+  out << "  \"" << name << "\": ";
+  if (s.count == 0) {
+    out << "null,\n";
+    return;
+  }
+  out << "{\"count\": " << s.count << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50
+      << ", \"p95\": " << s.p95 << ", \"max\": " << s.max << "},\n";
+}
+
+static void writeReport(std::ostream& out, const Options& options, const RunReport& report) {
+  // ru_maxrss is in KiB on Linux
+  rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+  auto flag = [](bool b) {
+    return b ? "true" : "false";
+  };
+
+  out << "{\n"
+      << "  \"meshes\": " << report.meshes << ",\n"
+      << "  \"triangles_per_mesh\": " << options.stress_triangles << ",\n"
+      << "  \"instancing\": " << options.stress_instancing << ",\n"
+      << "  \"animated\": " << options.stress_animated << ",\n"
+      << "  \"geometries\": " << report.geometries << ",\n"
+      << "  \"streams\": " << report.streams << ",\n"
+      << "  \"gpu_transforms\": " << flag(options.gpu_transforms) << ",\n"
+      << "  \"prerecord\": " << flag(options.prerecord) << ",\n"
+      << "  \"bindless\": " << flag(options.bindless) << ",\n"
+      << "  \"frames\": " << report.frames << ",\n"
+      << "  \"seconds\": " << report.seconds << ",\n"
+      << "  \"draws_per_frame\": " << report.draws << ",\n"
+      << "  \"triangles_per_frame\": " << report.triangles << ",\n";
+  writeTimes(out, "cpu_frame_ms", report.cpu_ms);
+  writeTimes(out, "gpu_frame_ms", report.gpu_ms);
+  out << "  \"peak_device_bytes\": " << report.peak_device_bytes << ",\n"
+      << "  \"peak_rss_bytes\": " << uint64_t(usage.ru_maxrss) * 1024 << ",\n"
+      << "  \"heap_allocations\": " << report.heap_allocations << "\n"
+      << "}\n";
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argv[1][0] == '-') {
+    std::cerr << "usage: " << argv[0] << " <report.json> [options]\n";
+    return 1;
+  }
+  try {
+    // whatever follows the report is parsed as regular options
+    std::string path = argv[1];
+    argv[1] = argv[0];
+    Options options = parseOptions(argc - 1, argv + 1);
+    if (!options.replay.empty()) {
+      throw std::runtime_error("the benchmark renders a stress scene, not a replay");
+    }
+    options.headless = true;
+    if (options.stress_meshes == 0) {
+      options.stress_meshes = DEFAULT_MESHES;
+    }
+    if (options.frames == 0) {
+      options.frames = DEFAULT_FRAMES;
+    }
+    Application app(options);
+    app.run();
+
+    std::ofstream out(path);
+    writeReport(out, options, app.report());
+    if (!out) {
+      throw std::runtime_error("cannot write " + path);
+    }
+    std::cout << "Wrote " << path << "\n";
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
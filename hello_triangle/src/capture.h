@@ -0,0 +1,277 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "render_queue.h"
+#include "scene_graph.h"
+
+// Binary record of everything the renderer consumed, for replaying a run
+// without the game: geometry uploads and entities once, then per frame the
+// camera, the transforms that changed and the sorted draw list.
+//
+// Host byte order, tightly packed. The file is a header followed by chunks
+// of {u32 type, u64 payload size, payload}:
+//
+//   GEOMETRY  u32 n_xs, n_colors, n_inds; vec3 xs[]; vec3 colors[]; u32 inds[]
+//   ENTITIES  u32 n_nodes, n_entities; {u32 node, geometry; vec4 bounds;
+//             f32 opacity}[]
+//   FRAME     mat4 view, proj; u32 n_ranges, n_draws; {u32 first, count}[];
+//             mat4 transforms[sum of counts]; {u64 key; u32 index}[]
+//
+// Entity rows are in MeshStore order, which draw indices refer to.
+namespace capture {
+
+constexpr uint32_t MAGIC = 0x50414348; // "HCAP"
+constexpr uint32_t VERSION = 1;
+
+enum ChunkType : uint32_t {
+  CHUNK_GEOMETRY = 1,
+  CHUNK_ENTITIES,
+  CHUNK_FRAME,
+};
+
+struct Geometry {
+  std::vector<glm::vec3> xs;
+  std::vector<glm::vec3> colors;
+  std::vector<uint32_t> inds;
+};
+
+struct Entity {
+  uint32_t node;
+  uint32_t geometry;
+  // bounding sphere: center, radius
+  glm::vec4 bounds;
+  float opacity;
+};
+
+struct Frame {
+  glm::mat4 view;
+  glm::mat4 proj;
+  std::vector<NodeRange> ranges;
+  // world matrices for ranges, back to back
+  std::vector<glm::mat4> transforms;
+  std::vector<DrawItem> draws;
+};
+
+class Writer {
+ public:
+  explicit Writer(const std::string& path)
+      : m_file(path, std::ios::binary | std::ios::trunc) {
+    if (!m_file) {
+      throw std::runtime_error("failed to open capture file " + path);
+    }
+    put(MAGIC);
+    put(VERSION);
+    flushChunk(0);
+  }
+
+  void writeGeometry(
+      const std::vector<glm::vec3>& xs, const std::vector<glm::vec3>& colors,
+      const std::vector<uint32_t>& inds) {
+    put<uint32_t>(xs.size());
+    put<uint32_t>(colors.size());
+    put<uint32_t>(inds.size());
+    putArray(xs.data(), xs.size());
+    putArray(colors.data(), colors.size());
+    putArray(inds.data(), inds.size());
+    flushChunk(CHUNK_GEOMETRY);
+  }
+
+  void writeEntities(uint32_t n_nodes, const std::vector<Entity>& entities) {
+    put(n_nodes);
+    put<uint32_t>(entities.size());
+    for (const auto& entity : entities) {
+      put(entity.node);
+      put(entity.geometry);
+      put(entity.bounds);
+      put(entity.opacity);
+    }
+    flushChunk(CHUNK_ENTITIES);
+  }
+
+  // ranges index into world, the scene's full world matrix array
+  void writeFrame(
+      const glm::mat4& view, const glm::mat4& proj,
+      const std::vector<NodeRange>& ranges, const glm::mat4* world,
+      const std::vector<DrawItem>& draws) {
+    put(view);
+    put(proj);
+    put<uint32_t>(ranges.size());
+    put<uint32_t>(draws.size());
+    for (const auto& range : ranges) {
+      put(range.first);
+      put(range.count);
+    }
+    for (const auto& range : ranges) {
+      putArray(world + range.first, range.count);
+    }
+    for (const auto& draw : draws) {
+      put(draw.key);
+      put(draw.index);
+    }
+    flushChunk(CHUNK_FRAME);
+    m_frames++;
+  }
+
+  uint64_t frames() const {
+    return m_frames;
+  }
+
+ private:
+  template<typename T>
+  void put(const T& value) {
+    putArray(&value, 1);
+  }
+
+  template<typename T>
+  void putArray(const T* values, size_t count) {
+    auto bytes = reinterpret_cast<const char*>(values);
+    m_chunk.insert(m_chunk.end(), bytes, bytes + count * sizeof(T));
+  }
+
+  // type 0 writes the pending bytes without a chunk header
+  void flushChunk(uint32_t type) {
+    if (type != 0) {
+      uint64_t size = m_chunk.size();
+      m_file.write(reinterpret_cast<const char*>(&type), sizeof(type));
+      m_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    }
+    m_file.write(m_chunk.data(), m_chunk.size());
+    if (!m_file) {
+      throw std::runtime_error("failed to write capture");
+    }
+    m_chunk.clear();
+  }
+
+  std::ofstream m_file;
+  // payload of the chunk being built, reused between chunks
+  std::vector<char> m_chunk;
+  uint64_t m_frames = 0;
+};
+
+// Loads a whole capture up front, so replay does no I/O.
+class Reader {
+ public:
+  explicit Reader(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("failed to open capture file " + path);
+    }
+    m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (get<uint32_t>() != MAGIC) {
+      throw std::runtime_error(path + " is not a capture file");
+    }
+    if (get<uint32_t>() != VERSION) {
+      throw std::runtime_error(path + " has an unsupported capture version");
+    }
+    while (m_pos < m_data.size()) {
+      auto type = get<uint32_t>();
+      auto size = get<uint64_t>();
+      size_t end = m_pos + size;
+      if (end > m_data.size()) {
+        throw std::runtime_error("truncated capture chunk");
+      }
+      switch (type) {
+        case CHUNK_GEOMETRY: readGeometry(); break;
+        case CHUNK_ENTITIES: readEntities(); break;
+        case CHUNK_FRAME: readFrame(); break;
+        // unknown chunks are skipped
+        default: break;
+      }
+      m_pos = end;
+    }
+    m_data.clear();
+    m_data.shrink_to_fit();
+  }
+
+  uint32_t nodeCount() const {
+    return m_n_nodes;
+  }
+  const std::vector<Geometry>& geometries() const {
+    return m_geometries;
+  }
+  const std::vector<Entity>& entities() const {
+    return m_entities;
+  }
+  const std::vector<Frame>& frames() const {
+    return m_frames;
+  }
+
+ private:
+  template<typename T>
+  T get() {
+    T value;
+    getArray(&value, 1);
+    return value;
+  }
+
+  template<typename T>
+  void getArray(T* values, size_t count) {
+    size_t size = count * sizeof(T);
+    if (m_pos + size > m_data.size()) {
+      throw std::runtime_error("truncated capture");
+    }
+    memcpy(static_cast<void*>(values), m_data.data() + m_pos, size);
+    m_pos += size;
+  }
+
+  void readGeometry() {
+    Geometry geometry;
+    geometry.xs.resize(get<uint32_t>());
+    geometry.colors.resize(get<uint32_t>());
+    geometry.inds.resize(get<uint32_t>());
+    getArray(geometry.xs.data(), geometry.xs.size());
+    getArray(geometry.colors.data(), geometry.colors.size());
+    getArray(geometry.inds.data(), geometry.inds.size());
+    m_geometries.push_back(std::move(geometry));
+  }
+
+  void readEntities() {
+    m_n_nodes = get<uint32_t>();
+    m_entities.resize(get<uint32_t>());
+    for (auto& entity : m_entities) {
+      entity.node = get<uint32_t>();
+      entity.geometry = get<uint32_t>();
+      entity.bounds = get<glm::vec4>();
+      entity.opacity = get<float>();
+    }
+  }
+
+  void readFrame() {
+    Frame frame;
+    frame.view = get<glm::mat4>();
+    frame.proj = get<glm::mat4>();
+    frame.ranges.resize(get<uint32_t>());
+    frame.draws.resize(get<uint32_t>());
+    size_t n_transforms = 0;
+    for (auto& range : frame.ranges) {
+      range.first = get<uint32_t>();
+      range.count = get<uint32_t>();
+      n_transforms += range.count;
+    }
+    frame.transforms.resize(n_transforms);
+    getArray(frame.transforms.data(), n_transforms);
+    for (auto& draw : frame.draws) {
+      draw.key = get<uint64_t>();
+      draw.index = get<uint32_t>();
+    }
+    m_frames.push_back(std::move(frame));
+  }
+
+  std::vector<char> m_data;
+  size_t m_pos = 0;
+  uint32_t m_n_nodes = 0;
+  std::vector<Geometry> m_geometries;
+  std::vector<Entity> m_entities;
+  std::vector<Frame> m_frames;
+};
+
+} // namespace capture
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Handle to an entity in a ComponentStore. The slot generation is bumped
+// when an entity is destroyed, so stale handles are caught rather than
+// silently referring to whatever reused the slot.
+struct Entity {
+  uint32_t index = ~0u;
+  uint32_t generation = 0;
+
+  bool operator==(const Entity&) const = default;
+};
+
+// Entities with one tightly packed array per component. Live entities
+// occupy rows [0, size()) of every array; destroying one moves the last row
+// into the hole, so per-frame loops walk only the arrays they need and
+// never skip dead entries. Rows are not stable, handles are.
+template<typename... Components>
+class ComponentStore {
+ public:
+  Entity create(Components... values) {
+    uint32_t index;
+    if (!m_free.empty()) {
+      index = m_free.back();
+      m_free.pop_back();
+    }
+    else {
+      index = m_slots.size();
+      m_slots.push_back({});
+    }
+    m_slots[index].row = m_rows.size();
+    m_rows.push_back(index);
+    std::apply([&](auto&... columns) {
+      (columns.push_back(std::move(values)), ...);
+    }, m_columns);
+    return {index, m_slots[index].generation};
+  }
+
+  void destroy(Entity entity) {
+    uint32_t dead = row(entity);
+    uint32_t last = m_rows.size() - 1;
+    if (dead != last) {
+      std::apply([&](auto&... columns) {
+        ((columns[dead] = std::move(columns[last])), ...);
+      }, m_columns);
+      m_rows[dead] = m_rows[last];
+      m_slots[m_rows[dead]].row = dead;
+    }
+    std::apply([](auto&... columns) {
+      (columns.pop_back(), ...);
+    }, m_columns);
+    m_rows.pop_back();
+    m_slots[entity.index].generation++;
+    m_free.push_back(entity.index);
+  }
+
+  bool alive(Entity entity) const {
+    return entity.index < m_slots.size()
+        && m_slots[entity.index].generation == entity.generation
+        && m_slots[entity.index].row < m_rows.size()
+        && m_rows[m_slots[entity.index].row] == entity.index;
+  }
+
+  // current row of a live entity
+  uint32_t row(Entity entity) const {
+    if (!alive(entity)) {
+      throw std::runtime_error("stale entity handle");
+    }
+    return m_slots[entity.index].row;
+  }
+
+  Entity entity(uint32_t row) const {
+    uint32_t index = m_rows[row];
+    return {index, m_slots[index].generation};
+  }
+
+  uint32_t size() const {
+    return m_rows.size();
+  }
+
+  // whole component array, indexed by row
+  template<size_t I>
+  auto& column() {
+    return std::get<I>(m_columns);
+  }
+  template<size_t I>
+  const auto& column() const {
+    return std::get<I>(m_columns);
+  }
+
+  template<size_t I>
+  auto& get(Entity entity) {
+    return std::get<I>(m_columns)[row(entity)];
+  }
+  template<size_t I>
+  const auto& get(Entity entity) const {
+    return std::get<I>(m_columns)[row(entity)];
+  }
+
+ private:
+  struct Slot {
+    uint32_t row = 0;
+    uint32_t generation = 0;
+  };
+
+  std::tuple<std::vector<Components>...> m_columns;
+  // slot index of the entity in each row
+  std::vector<uint32_t> m_rows;
+  std::vector<Slot> m_slots;
+  std::vector<uint32_t> m_free;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Bump allocator for transient per-frame GPU data. One persistently mapped
+// buffer is split into a region per frame in flight; reset() a region once
+// its frame's fence has signaled, then alloc() hands out aligned ranges of
+// it. Offsets are from the start of the buffer, ready to pass as dynamic
+// descriptor offsets against a descriptor based at 0.
+class FrameAllocator {
+ public:
+  struct Allocation {
+    void* data;
+    uint32_t offset;
+  };
+
+  FrameAllocator() = default;
+  // region_size must be a multiple of every alignment later requested
+  FrameAllocator(void* mmap, uint32_t region_size, uint32_t regions)
+      : m_base(static_cast<uint8_t*>(mmap)), m_region_size(region_size), m_regions(regions) {}
+
+  void reset(uint32_t region) {
+    if (region >= m_regions) {
+      throw std::runtime_error("frame allocator has no region " + std::to_string(region));
+    }
+    m_begin = region * m_region_size;
+    m_head = m_begin;
+  }
+
+  // alignment must be a power of two
+  Allocation alloc(uint32_t size, uint32_t alignment) {
+    uint32_t offset = (m_head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > m_begin + m_region_size) {
+      throw std::runtime_error(
+          "frame allocator out of space: " + std::to_string(size) + " bytes requested, "
+          + std::to_string(m_region_size - (m_head - m_begin)) + " left");
+    }
+    m_head = offset + size;
+    if (m_head - m_begin > m_peak) {
+      m_peak = m_head - m_begin;
+    }
+    return {m_base + offset, offset};
+  }
+
+  template<typename T>
+  T* alloc(uint32_t alignment, uint32_t& offset) {
+    auto allocation = alloc(sizeof(T), alignment);
+    offset = allocation.offset;
+    return static_cast<T*>(allocation.data);
+  }
+
+  // bytes handed out from the current region
+  uint32_t used() const {
+    return m_head - m_begin;
+  }
+
+  // most bytes any one frame has used
+  uint32_t peak() const {
+    return m_peak;
+  }
+
+  uint32_t regionSize() const {
+    return m_region_size;
+  }
+
+ private:
+  uint8_t* m_base = nullptr;
+  uint32_t m_region_size = 0;
+  uint32_t m_regions = 0;
+  uint32_t m_begin = 0;
+  uint32_t m_head = 0;
+  uint32_t m_peak = 0;
+};
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes frames read back from the GPU on a background thread, so the
+// render loop never waits on encoding or I/O unless every slot is busy.
+// Pixels stay in caller-owned slots (mapped readback buffers): the caller
+// acquire()s a slot, fills it, and push()es it; the slot is handed back
+// once written. Targets:
+//
+//   "|cmd"         raw RGBA8 frames piped to cmd's stdin, e.g. an encoder
+//   "dir/%05d.png" one PNG per frame, numbered from 0
+//   "dir/%05d.rgba" one raw RGBA8 file per frame (any other extension)
+//
+// Buffers are sized up front, so steady-state writing does not allocate.
+class FrameWriter {
+ public:
+  enum class Format {
+    RAW,
+    PNG,
+    PIPE,
+  };
+
+  // slots hold up to max_width * max_height tightly packed 4-byte pixels,
+  // BGRA if bgra is set, RGBA otherwise
+  FrameWriter(
+      const std::string& target, std::vector<const uint8_t*> slots,
+      uint32_t max_width, uint32_t max_height, bool bgra)
+      : m_target(target), m_slots(std::move(slots)), m_bgra(bgra),
+        m_queue(m_slots.size()) {
+    if (!target.empty() && target[0] == '|') {
+      m_format = Format::PIPE;
+      m_pipe = popen(target.c_str() + 1, "w");
+      if (!m_pipe) {
+        throw std::runtime_error("failed to start " + target.substr(1));
+      }
+    }
+    else {
+      auto ext = target.rfind('.');
+      m_format = ext != std::string::npos && target.substr(ext) == ".png"
+          ? Format::PNG : Format::RAW;
+      if (target.find('%') == std::string::npos) {
+        throw std::runtime_error("export path needs a frame number, e.g. frame_%05d.png");
+      }
+    }
+    size_t pixels = (size_t)max_width * max_height;
+    m_rgba.resize(pixels * 4);
+    if (m_format == Format::PNG) {
+      size_t raw = (size_t)max_height * (1 + (size_t)max_width * 4);
+      m_png.resize(PNG_OVERHEAD + raw + 5 * (raw / STORED_BLOCK + 1));
+    }
+    for (uint32_t i = 0; i < m_slots.size(); ++i) {
+      m_free.push_back(i);
+    }
+    m_thread = std::thread([this] { run(); });
+  }
+
+  // errors are only reported by an explicit finish()
+  ~FrameWriter() {
+    try {
+      finish();
+    }
+    catch (const std::exception&) {
+    }
+  }
+
+  FrameWriter(const FrameWriter&) = delete;
+  FrameWriter& operator=(const FrameWriter&) = delete;
+
+  // a slot nobody is reading; waits for the writer if all are busy
+  uint32_t acquire() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return !m_free.empty() || m_error; });
+    if (m_error) {
+      throw std::runtime_error(m_error_msg);
+    }
+    uint32_t slot = m_free.back();
+    m_free.pop_back();
+    return slot;
+  }
+
+  // write the frame in slot, then free it
+  void push(uint32_t slot, uint64_t frame, uint32_t width, uint32_t height) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_queue[(m_head + m_queued) % m_queue.size()] = {slot, frame, width, height};
+      m_queued++;
+    }
+    m_cv.notify_all();
+  }
+
+  // free a slot without writing it
+  void release(uint32_t slot) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_free.push_back(slot);
+    }
+    m_cv.notify_all();
+  }
+
+  // write everything pushed so far and stop; rethrows a write error
+  void finish() {
+    if (!m_thread.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    if (m_pipe) {
+      pclose(m_pipe);
+      m_pipe = nullptr;
+    }
+    if (m_error) {
+      throw std::runtime_error(m_error_msg);
+    }
+  }
+
+  uint64_t written() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+  }
+
+ private:
+  struct Job {
+    uint32_t slot;
+    uint64_t frame;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  // zlib header and adler32, PNG signature, IHDR and IEND chunks, IDAT
+  // chunk header and crc
+  static constexpr size_t PNG_OVERHEAD = 2 + 4 + 8 + 25 + 12 + 12;
+  // largest stored (uncompressed) deflate block
+  static constexpr size_t STORED_BLOCK = 65535;
+
+  void run() {
+    while (true) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_queued > 0 || m_stop; });
+        if (m_queued == 0) {
+          return;
+        }
+        job = m_queue[m_head];
+        m_head = (m_head + 1) % m_queue.size();
+        m_queued--;
+      }
+      try {
+        write(job);
+      }
+      catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = true;
+        m_error_msg = e.what();
+      }
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(job.slot);
+        m_written++;
+      }
+      m_cv.notify_all();
+    }
+  }
+
+  void write(const Job& job) {
+    size_t bytes = (size_t)job.width * job.height * 4;
+    const uint8_t* pixels = m_slots[job.slot];
+    if (m_bgra) {
+      for (size_t i = 0; i < bytes; i += 4) {
+        m_rgba[i + 0] = pixels[i + 2];
+        m_rgba[i + 1] = pixels[i + 1];
+        m_rgba[i + 2] = pixels[i + 0];
+        m_rgba[i + 3] = pixels[i + 3];
+      }
+      pixels = m_rgba.data();
+    }
+
+    if (m_format == Format::PIPE) {
+      writeAll(fileno(m_pipe), pixels, bytes);
+      return;
+    }
+    formatPath(job.frame);
+    int fd = ::open(m_path.data(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw std::runtime_error(std::string("failed to open ") + m_path.data());
+    }
+    if (m_format == Format::PNG) {
+      size_t size = encodePng(pixels, job.width, job.height);
+      writeAll(fd, m_png.data(), size);
+    }
+    else {
+      writeAll(fd, pixels, bytes);
+    }
+    ::close(fd);
+  }
+
+  static void writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+      ssize_t n = ::write(fd, data, size);
+      if (n < 0) {
+        throw std::runtime_error("failed to write exported frame");
+      }
+      data += n;
+      size -= n;
+    }
+  }
+
+  // substitutes the frame number for the first %d (with optional zero
+  // padding width, e.g. %05d) in the target
+  void formatPath(uint64_t frame) {
+    size_t pct = m_target.find('%');
+    size_t end = pct + 1;
+    int width = 0;
+    while (end < m_target.size() && m_target[end] >= '0' && m_target[end] <= '9') {
+      width = width * 10 + (m_target[end++] - '0');
+    }
+    if (end >= m_target.size() || m_target[end] != 'd') {
+      throw std::runtime_error("export path needs %d or %0Nd, got " + m_target);
+    }
+    std::array<char, 32> number;
+    snprintf(number.data(), number.size(), "%0*llu", width, (unsigned long long)frame);
+    int n = snprintf(
+        m_path.data(), m_path.size(), "%.*s%s%s", (int)pct, m_target.c_str(),
+        number.data(), m_target.c_str() + end + 1);
+    if (n < 0 || (size_t)n >= m_path.size()) {
+      throw std::runtime_error("export path too long");
+    }
+  }
+
+  // 8-bit RGBA PNG with stored (uncompressed) deflate blocks: cheap to
+  // produce at full frame rate, and any encoder can recompress offline
+  size_t encodePng(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    uint8_t* out = m_png.data();
+    size_t pos = 0;
+    auto put = [&](const void* data, size_t size) {
+      memcpy(out + pos, data, size);
+      pos += size;
+    };
+    auto put32 = [&](uint32_t v) {
+      uint8_t be[4] = {uint8_t(v >> 24), uint8_t(v >> 16), uint8_t(v >> 8), uint8_t(v)};
+      put(be, 4);
+    };
+    // chunk: length, type, data, crc of type and data
+    auto beginChunk = [&](const char* type) {
+      size_t start = pos;
+      put32(0);
+      put(type, 4);
+      return start;
+    };
+    auto endChunk = [&](size_t start) {
+      uint32_t length = pos - start - 8;
+      uint8_t be[4] = {
+        uint8_t(length >> 24), uint8_t(length >> 16), uint8_t(length >> 8), uint8_t(length)};
+      memcpy(out + start, be, 4);
+      put32(crc32(out + start + 4, length + 4));
+    };
+
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    put(signature, 8);
+
+    size_t ihdr = beginChunk("IHDR");
+    put32(width);
+    put32(height);
+    // 8 bits per channel, RGBA, deflate, no filter, no interlace
+    const uint8_t format[5] = {8, 6, 0, 0, 0};
+    put(format, 5);
+    endChunk(ihdr);
+
+    size_t idat = beginChunk("IDAT");
+    const uint8_t zlib_header[2] = {0x78, 0x01};
+    put(zlib_header, 2);
+    // each row is prefixed by its filter type (0, none); rows are fed into
+    // stored blocks of at most STORED_BLOCK bytes
+    size_t row_bytes = (size_t)width * 4;
+    size_t raw = (size_t)height * (1 + row_bytes);
+    uint32_t adler_a = 1, adler_b = 0;
+    size_t row = 0, col = 0;
+    for (size_t done = 0; done < raw;) {
+      size_t block = std::min(raw - done, STORED_BLOCK);
+      uint8_t header[5] = {
+        uint8_t(done + block == raw), uint8_t(block), uint8_t(block >> 8),
+        uint8_t(~block), uint8_t(~block >> 8)};
+      put(header, 5);
+      for (size_t left = block; left > 0;) {
+        const uint8_t* src;
+        size_t n;
+        const uint8_t filter = 0;
+        if (col == 0) {
+          src = &filter;
+          n = 1;
+        }
+        else {
+          n = std::min(left, row_bytes - (col - 1));
+          src = rgba + row * row_bytes + (col - 1);
+        }
+        put(src, n);
+        for (size_t i = 0; i < n; ++i) {
+          adler_a = (adler_a + src[i]) % 65521;
+          adler_b = (adler_b + adler_a) % 65521;
+        }
+        left -= n;
+        col += n;
+        if (col == row_bytes + 1) {
+          col = 0;
+          row++;
+        }
+      }
+      done += block;
+    }
+    put32((adler_b << 16) | adler_a);
+    endChunk(idat);
+
+    size_t iend = beginChunk("IEND");
+    endChunk(iend);
+    return pos;
+  }
+
+  static uint32_t crc32(const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+      std::array<uint32_t, 256> t = {};
+      for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+          c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        t[n] = c;
+      }
+      return t;
+    }();
+    uint32_t c = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i) {
+      c = table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffffu;
+  }
+
+  std::string m_target;
+  Format m_format;
+  std::vector<const uint8_t*> m_slots;
+  bool m_bgra;
+  FILE* m_pipe = nullptr;
+  // scratch, sized for the largest frame
+  std::vector<uint8_t> m_rgba;
+  std::vector<uint8_t> m_png;
+  std::array<char, 4096> m_path;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  // pushed frames, a ring as long as there are slots
+  std::vector<Job> m_queue;
+  size_t m_head = 0;
+  size_t m_queued = 0;
+  std::vector<uint32_t> m_free;
+  bool m_stop = false;
+  bool m_error = false;
+  std::string m_error_msg;
+  uint64_t m_written = 0;
+  std::thread m_thread;
+};
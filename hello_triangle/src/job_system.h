@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct Job;
+
+// Counts outstanding jobs. Doubles as a dependency: jobs submitted with
+// `after` set to a counter only start once that counter reaches zero.
+struct JobCounter {
+  std::atomic<int> pending = 0;
+ private:
+  friend class JobSystem;
+  std::mutex m_lock;
+  // jobs waiting for this counter, linked through Job::next
+  Job* m_waiting = nullptr;
+};
+
+struct Job {
+  using Fn = void (*)(void* data, uint32_t begin, uint32_t end);
+  Fn fn;
+  void* data;
+  uint32_t begin;
+  uint32_t end;
+  JobCounter* counter;
+  // next job waiting on the same counter, or in the free list
+  Job* next;
+};
+
+// Work-stealing scheduler. Each worker owns a deque: it pushes and pops
+// its own end (LIFO, cache friendly), idle workers steal from the other
+// end (FIFO, oldest and usually largest work first). The thread that
+// constructed the system is worker 0 and runs jobs while it waits.
+//
+// Jobs come from a fixed pool, returned to it once they have run, and
+// deques have fixed capacity, so submitting does not allocate.
+class JobSystem {
+ public:
+  static constexpr uint32_t MAX_JOBS = 4096;
+  static constexpr uint32_t DEQUE_CAPACITY = MAX_JOBS;
+
+  explicit JobSystem(unsigned n_threads = std::thread::hardware_concurrency())
+      : m_deques(std::max(n_threads, 1u)) {
+    for (uint32_t i = 0; i + 1 < MAX_JOBS; ++i) {
+      m_jobs[i].next = &m_jobs[i + 1];
+    }
+    m_jobs[MAX_JOBS - 1].next = nullptr;
+    m_free = &m_jobs[0];
+    t_worker = 0;
+    for (unsigned i = 1; i < m_deques.size(); ++i) {
+      m_threads.emplace_back([this, i]() { workerLoop(i); });
+    }
+  }
+
+  ~JobSystem() {
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_lock);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  unsigned workerCount() const {
+    return m_deques.size();
+  }
+
+  // run fn(data, begin, end) on some worker
+  void submit(
+      Job::Fn fn, void* data, uint32_t begin, uint32_t end,
+      JobCounter* counter, JobCounter* after = nullptr) {
+    Job* job = allocJob();
+    *job = {fn, data, begin, end, counter, nullptr};
+    if (counter) {
+      counter->pending.fetch_add(1);
+    }
+    if (after) {
+      std::lock_guard<std::mutex> lock(after->m_lock);
+      if (after->pending.load() > 0) {
+        job->next = after->m_waiting;
+        after->m_waiting = job;
+        return;
+      }
+    }
+    push(job);
+  }
+
+  // help out with queued jobs until the counter drains
+  void wait(JobCounter& counter) {
+    while (counter.pending.load() > 0) {
+      Job* job = pop(currentWorker());
+      if (!job) {
+        job = steal(currentWorker());
+      }
+      if (job) {
+        run(job);
+      }
+      else {
+        std::this_thread::yield();
+      }
+    }
+    // the job that finished the counter may still hold its lock
+    std::lock_guard<std::mutex> lock(counter.m_lock);
+  }
+
+  // fn(begin, end) over [0, count) in chunks of at most grain, blocking
+  template<typename Fn>
+  void parallelFor(uint32_t count, uint32_t grain, const Fn& fn) {
+    if (count <= grain) {
+      if (count > 0) {
+        fn(0, count);
+      }
+      return;
+    }
+    JobCounter counter;
+    auto trampoline = [](void* data, uint32_t begin, uint32_t end) {
+      (*static_cast<const Fn*>(data))(begin, end);
+    };
+    for (uint32_t begin = 0; begin < count; begin += grain) {
+      uint32_t end = std::min(count, begin + grain);
+      submit(trampoline, const_cast<Fn*>(&fn), begin, end, &counter);
+    }
+    wait(counter);
+  }
+
+ private:
+  // bounded deque guarded by a lock; contention is limited to steals
+  struct WorkDeque {
+    std::mutex lock;
+    std::array<Job*, DEQUE_CAPACITY> jobs;
+    uint32_t top = 0;
+    uint32_t bottom = 0;
+  };
+
+  // queued, parked on a counter or running jobs keep their slot
+  Job* allocJob() {
+    std::lock_guard<std::mutex> lock(m_free_lock);
+    if (!m_free) {
+      throw std::runtime_error("job pool full");
+    }
+    Job* job = m_free;
+    m_free = job->next;
+    return job;
+  }
+
+  void freeJob(Job* job) {
+    std::lock_guard<std::mutex> lock(m_free_lock);
+    job->next = m_free;
+    m_free = job;
+  }
+
+  unsigned currentWorker() const {
+    // threads outside the system (if any) share worker 0's deque
+    return t_worker < m_deques.size() ? t_worker : 0;
+  }
+
+  void push(Job* job) {
+    auto& deque = m_deques[currentWorker()];
+    {
+      std::lock_guard<std::mutex> lock(deque.lock);
+      if (deque.bottom - deque.top >= DEQUE_CAPACITY) {
+        throw std::runtime_error("job deque full");
+      }
+      deque.jobs[deque.bottom++ % DEQUE_CAPACITY] = job;
+    }
+    m_queued.fetch_add(1);
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_lock);
+    }
+    m_wake.notify_one();
+  }
+
+  Job* pop(unsigned worker) {
+    auto& deque = m_deques[worker];
+    std::lock_guard<std::mutex> lock(deque.lock);
+    if (deque.bottom == deque.top) {
+      return nullptr;
+    }
+    m_queued.fetch_sub(1);
+    return deque.jobs[--deque.bottom % DEQUE_CAPACITY];
+  }
+
+  Job* steal(unsigned thief) {
+    for (unsigned i = 1; i < m_deques.size(); ++i) {
+      auto& deque = m_deques[(thief + i) % m_deques.size()];
+      std::lock_guard<std::mutex> lock(deque.lock);
+      if (deque.bottom == deque.top) {
+        continue;
+      }
+      m_queued.fetch_sub(1);
+      return deque.jobs[deque.top++ % DEQUE_CAPACITY];
+    }
+    return nullptr;
+  }
+
+  void run(Job* job) {
+    job->fn(job->data, job->begin, job->end);
+    JobCounter* counter = job->counter;
+    freeJob(job);
+    if (!counter) {
+      return;
+    }
+    // decrement under the lock so a waiter cannot return (and destroy the
+    // counter) before we are done with it; see wait()
+    Job* waiting = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(counter->m_lock);
+      if (counter->pending.fetch_sub(1) == 1) {
+        // last job of the counter: release its dependents
+        waiting = counter->m_waiting;
+        counter->m_waiting = nullptr;
+      }
+    }
+    while (waiting) {
+      Job* next = waiting->next;
+      push(waiting);
+      waiting = next;
+    }
+  }
+
+  void workerLoop(unsigned worker) {
+    t_worker = worker;
+    while (true) {
+      Job* job = pop(worker);
+      if (!job) {
+        job = steal(worker);
+      }
+      if (job) {
+        run(job);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(m_sleep_lock);
+      m_wake.wait(lock, [this]() { return m_stop || m_queued.load() > 0; });
+      if (m_stop) {
+        return;
+      }
+    }
+  }
+
+  static inline thread_local unsigned t_worker = ~0u;
+
+  std::vector<WorkDeque> m_deques;
+  std::vector<std::thread> m_threads;
+  std::unique_ptr<Job[]> m_jobs = std::make_unique<Job[]>(MAX_JOBS);
+  std::mutex m_free_lock;
+  Job* m_free = nullptr;
+  // jobs sitting in any deque, for waking sleepers
+  std::atomic<int> m_queued = 0;
+  std::mutex m_sleep_lock;
+  std::condition_variable m_wake;
+  bool m_stop = false;
+};
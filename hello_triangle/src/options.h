@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Command line settings. The device can also come from the environment
+// (for CI and benchmark hosts); the command line wins.
+struct Options {
+  // physical device override: enumeration index, device UUID or a
+  // case-insensitive substring of the device name; empty picks the best
+  std::string device;
+  // render offscreen without a window or swapchain
+  bool headless = false;
+  // offscreen target size when headless
+  uint32_t width = 800;
+  uint32_t height = 600;
+  // stop after this many frames, 0 runs until closed (or the replay ends)
+  uint64_t frames = 0;
+  // fail if a frame allocates from the heap once warmed up
+  bool assert_no_alloc = false;
+  // record the frames rendered to this file
+  std::string capture;
+  // render the frames of this capture instead of the game; implies headless
+  std::string replay;
+  // animate and compose model matrices in a compute pass instead of on the
+  // CPU; needs a flat scene and cannot be captured
+  bool gpu_transforms = false;
+  // report GPU pipeline statistics and CPU submission counters
+  bool stats = false;
+  // draw everything additively without depth testing, brighter where more
+  // fragments land
+  bool overdraw = false;
+  // cameras rendered in one multiview pass, tiled side by side
+  uint32_t views = 1;
+  // write every rendered frame here, see FrameWriter
+  std::string export_target;
+  // record command buffers once and resubmit them until the draw list or
+  // swapchain changes
+  bool prerecord = false;
+  // GPU milliseconds a frame may take; when set the scene is rendered at a
+  // reduced resolution as needed and scaled up to the output, 0 disables
+  double frame_budget_ms = 0.0;
+  // shade with materials and textures from one descriptor-indexed table
+  // instead of vertex colors alone; needs descriptor indexing
+  bool bindless = false;
+  // render a generated scene of this many meshes instead of the game, see
+  // generateStressScene; 0 disables
+  uint32_t stress_meshes = 0;
+  uint32_t stress_triangles = 2;
+  // fraction of meshes drawing a geometry another mesh also draws
+  double stress_instancing = 0.0;
+  // fraction of meshes that spin
+  double stress_animated = 1.0;
+};
+
+// the top of the benchmark's scaling curve; how many distinct geometries
+// fit is up to the device, see Application::checkStressAllocations
+constexpr uint32_t MAX_STRESS_MESHES = 1000000;
+
+inline void printUsage(const char* argv0) {
+  std::cout
+      << "usage: " << argv0 << " [options]\n"
+      << "  --device <sel>  use the Vulkan device with this index, UUID or name\n"
+      << "                  (env HELLO_TRIANGLE_DEVICE)\n"
+      << "  --headless      render offscreen, without a window\n"
+      << "  --size <WxH>    offscreen size when headless (default 800x600)\n"
+      << "  --frames <n>    stop after n frames\n"
+      << "  --assert-no-alloc  fail on heap allocations in a warmed-up frame\n"
+      << "  --capture <f>   record rendered frames to f\n"
+      << "  --replay <f>    replay a capture headless and report throughput\n"
+      << "  --gpu-transforms  animate model matrices in a compute shader\n"
+      << "  --stats         report pipeline statistics and submission counters\n"
+      << "  --overdraw      visualize overdraw instead of shading\n"
+      << "  --views <n>     render n cameras around the scene in one pass (max 4)\n"
+      << "  --export <t>    write frames to t: \"out/%05d.png\", \"out/%05d.rgba\"\n"
+      << "                  or \"|command\" to pipe raw RGBA to an encoder\n"
+      << "  --prerecord     reuse recorded command buffers while the scene is static\n"
+      << "  --frame-budget <ms>  lower the scene resolution to keep GPU time under ms\n"
+      << "  --bindless      texture meshes through the bindless material table\n"
+      << "  --stress <n>    render n generated meshes instead of the game\n"
+      << "  --stress-triangles <n>  triangles per generated mesh (default 2)\n"
+      << "  --stress-instancing <f>  fraction of meshes sharing geometry (default 0)\n"
+      << "  --stress-animated <f>  fraction of meshes that spin (default 1)\n"
+      << "  --help          show this message\n";
+}
+
+inline Options parseOptions(int argc, char** argv) {
+  Options options;
+  if (const char* env = std::getenv("HELLO_TRIANGLE_DEVICE")) {
+    options.device = env;
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    // accepts both "--name value" and "--name=value"
+    auto value = [&](std::string_view name) -> const char* {
+      if (arg.size() > name.size() && arg.substr(0, name.size()) == name
+          && arg[name.size()] == '=') {
+        return argv[i] + name.size() + 1;
+      }
+      if (i + 1 >= argc) {
+        throw std::runtime_error(std::string("missing value for ") + std::string(name));
+      }
+      return argv[++i];
+    };
+    auto is = [&](std::string_view name) {
+      return arg == name || (arg.substr(0, name.size()) == name
+                             && arg.size() > name.size() && arg[name.size()] == '=');
+    };
+
+    if (arg == "--help" || arg == "-h") {
+      printUsage(argv[0]);
+      std::exit(0);
+    }
+    else if (is("--device")) {
+      options.device = value("--device");
+    }
+    else if (arg == "--headless") {
+      options.headless = true;
+    }
+    else if (is("--size")) {
+      std::string size = value("--size");
+      auto x = size.find('x');
+      if (x == std::string::npos) {
+        throw std::runtime_error("--size expects WxH, got " + size);
+      }
+      options.width = std::stoul(size.substr(0, x));
+      options.height = std::stoul(size.substr(x + 1));
+    }
+    else if (is("--frames")) {
+      options.frames = std::stoull(value("--frames"));
+    }
+    else if (arg == "--assert-no-alloc") {
+      options.assert_no_alloc = true;
+    }
+    else if (is("--capture")) {
+      options.capture = value("--capture");
+    }
+    else if (is("--replay")) {
+      options.replay = value("--replay");
+      options.headless = true;
+    }
+    else if (arg == "--gpu-transforms") {
+      options.gpu_transforms = true;
+    }
+    else if (arg == "--stats") {
+      options.stats = true;
+    }
+    else if (arg == "--overdraw") {
+      options.overdraw = true;
+    }
+    else if (is("--export")) {
+      options.export_target = value("--export");
+    }
+    else if (arg == "--prerecord") {
+      options.prerecord = true;
+    }
+    else if (is("--frame-budget")) {
+      options.frame_budget_ms = std::stod(value("--frame-budget"));
+      if (options.frame_budget_ms <= 0.0) {
+        throw std::runtime_error("--frame-budget expects a positive number of milliseconds");
+      }
+    }
+    else if (arg == "--bindless") {
+      options.bindless = true;
+    }
+    else if (is("--stress-triangles")) {
+      options.stress_triangles = std::stoul(value("--stress-triangles"));
+      if (options.stress_triangles < 1) {
+        throw std::runtime_error("--stress-triangles expects at least 1");
+      }
+    }
+    else if (is("--stress-instancing")) {
+      options.stress_instancing = std::stod(value("--stress-instancing"));
+      if (options.stress_instancing < 0.0 || options.stress_instancing > 1.0) {
+        throw std::runtime_error("--stress-instancing expects 0 to 1");
+      }
+    }
+    else if (is("--stress-animated")) {
+      options.stress_animated = std::stod(value("--stress-animated"));
+      if (options.stress_animated < 0.0 || options.stress_animated > 1.0) {
+        throw std::runtime_error("--stress-animated expects 0 to 1");
+      }
+    }
+    else if (is("--stress")) {
+      options.stress_meshes = std::stoul(value("--stress"));
+      if (options.stress_meshes < 1 || options.stress_meshes > MAX_STRESS_MESHES) {
+        throw std::runtime_error(
+            "--stress expects 1 to " + std::to_string(MAX_STRESS_MESHES) + " meshes");
+      }
+    }
+    else if (is("--views")) {
+      options.views = std::stoul(value("--views"));
+      if (options.views < 1 || options.views > 4) {
+        throw std::runtime_error("--views expects 1 to 4");
+      }
+    }
+    else {
+      throw std::runtime_error("unknown option " + std::string(arg));
+    }
+  }
+  if (!options.replay.empty() && !options.capture.empty()) {
+    throw std::runtime_error("--capture and --replay are mutually exclusive");
+  }
+  if (!options.replay.empty() && options.stress_meshes > 0) {
+    throw std::runtime_error("--stress and --replay are mutually exclusive");
+  }
+  if (options.gpu_transforms && !(options.replay.empty() && options.capture.empty())) {
+    throw std::runtime_error("--gpu-transforms cannot be combined with --capture or --replay");
+  }
+  // both record per-frame values (time, readback slot) into the commands
+  if (options.prerecord && (options.gpu_transforms || !options.export_target.empty())) {
+    throw std::runtime_error("--prerecord cannot be combined with --gpu-transforms or --export");
+  }
+  return options;
+}
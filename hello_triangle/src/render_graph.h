@@ -0,0 +1,711 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "vk_util.h"
+
+// How a pass touches a resource. Each usage implies the pipeline stages,
+// memory accesses and (for images) the layout the resource must be in.
+enum class RGUsage {
+  eColorAttachment,
+  eDepthAttachment,
+  eSampledFragment,
+  eStorageReadVertex,
+  eStorageReadCompute,
+  eStorageWriteCompute,
+  eUniformVertex,
+  eVertexBuffer,
+  eIndexBuffer,
+  eTransferSrc,
+  eTransferDst,
+};
+
+struct RGUsageInfo {
+  vk::PipelineStageFlags stages;
+  vk::AccessFlags access;
+  vk::ImageLayout layout;
+  vk::ImageUsageFlags image_usage;
+  bool write;
+};
+
+inline RGUsageInfo getUsageInfo(RGUsage usage) {
+  using Stage = vk::PipelineStageFlagBits;
+  using Access = vk::AccessFlagBits;
+  using Layout = vk::ImageLayout;
+  using ImageUsage = vk::ImageUsageFlagBits;
+  switch (usage) {
+    case RGUsage::eColorAttachment:
+      return {
+        Stage::eColorAttachmentOutput,
+        Access::eColorAttachmentRead | Access::eColorAttachmentWrite,
+        Layout::eColorAttachmentOptimal, ImageUsage::eColorAttachment, true,
+      };
+    case RGUsage::eDepthAttachment:
+      return {
+        Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+        Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite,
+        Layout::eDepthStencilAttachmentOptimal, ImageUsage::eDepthStencilAttachment, true,
+      };
+    case RGUsage::eSampledFragment:
+      return {
+        Stage::eFragmentShader, Access::eShaderRead,
+        Layout::eShaderReadOnlyOptimal, ImageUsage::eSampled, false,
+      };
+    case RGUsage::eStorageReadVertex:
+      return {
+        Stage::eVertexShader, Access::eShaderRead,
+        Layout::eGeneral, ImageUsage::eStorage, false,
+      };
+    case RGUsage::eStorageReadCompute:
+      return {
+        Stage::eComputeShader, Access::eShaderRead,
+        Layout::eGeneral, ImageUsage::eStorage, false,
+      };
+    case RGUsage::eStorageWriteCompute:
+      return {
+        Stage::eComputeShader, Access::eShaderWrite,
+        Layout::eGeneral, ImageUsage::eStorage, true,
+      };
+    case RGUsage::eUniformVertex:
+      return {
+        Stage::eVertexShader, Access::eUniformRead,
+        Layout::eUndefined, {}, false,
+      };
+    case RGUsage::eVertexBuffer:
+      return {
+        Stage::eVertexInput, Access::eVertexAttributeRead,
+        Layout::eUndefined, {}, false,
+      };
+    case RGUsage::eIndexBuffer:
+      return {
+        Stage::eVertexInput, Access::eIndexRead,
+        Layout::eUndefined, {}, false,
+      };
+    case RGUsage::eTransferSrc:
+      return {
+        Stage::eTransfer, Access::eTransferRead,
+        Layout::eTransferSrcOptimal, ImageUsage::eTransferSrc, false,
+      };
+    case RGUsage::eTransferDst:
+      return {
+        Stage::eTransfer, Access::eTransferWrite,
+        Layout::eTransferDstOptimal, ImageUsage::eTransferDst, true,
+      };
+  }
+  throw std::runtime_error("unknown render graph usage");
+}
+
+struct RGImageDesc {
+  vk::Extent2D extent;
+  vk::Format format;
+  vk::ImageAspectFlags aspect;
+  // array layers; layered images get a 2D array view
+  uint32_t layers = 1;
+};
+
+// Frame render graph. Passes declare the images and buffers they read and
+// write; compile() then culls passes that do not contribute to an output,
+// places transient images into shared memory when their lifetimes do not
+// overlap, and precomputes the pipeline barriers and layout transitions
+// needed before each pass. The graph is compiled once per swapchain and
+// executed every frame; imported resources (e.g. the swapchain image) are
+// rebound before each execute().
+class RenderGraph {
+ public:
+  using Resource = uint32_t;
+  using PassFn = std::function<void(vk::CommandBuffer&)>;
+
+  // Objects from a previous compile that frames still in flight may be
+  // using; destroy them once those frames have finished.
+  struct Garbage {
+    std::vector<vk::ImageView> views;
+    std::vector<vk::Image> images;
+    std::vector<vk::DeviceMemory> memory;
+  };
+
+  class PassBuilder {
+   public:
+    PassBuilder& read(Resource res, RGUsage usage) {
+      if (getUsageInfo(usage).write) {
+        throw std::runtime_error("render graph read with a write usage");
+      }
+      m_graph.m_passes[m_pass].accesses.push_back({res, usage});
+      return *this;
+    }
+    PassBuilder& write(Resource res, RGUsage usage) {
+      if (!getUsageInfo(usage).write) {
+        throw std::runtime_error("render graph write with a read usage");
+      }
+      m_graph.m_passes[m_pass].accesses.push_back({res, usage});
+      return *this;
+    }
+    // keep the pass even if none of its writes are consumed
+    PassBuilder& sideEffect() {
+      m_graph.m_passes[m_pass].side_effect = true;
+      return *this;
+    }
+   private:
+    friend class RenderGraph;
+    PassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+    RenderGraph& m_graph;
+    uint32_t m_pass;
+  };
+
+  Resource importImage(
+      const std::string& name, const RGImageDesc& desc,
+      vk::ImageLayout initial_layout, vk::PipelineStageFlags initial_stages,
+      vk::ImageLayout final_layout) {
+    ResourceNode node = {};
+    node.name = name;
+    node.is_image = true;
+    node.imported = true;
+    node.desc = desc;
+    node.initial_layout = initial_layout;
+    node.initial_stages = initial_stages;
+    node.final_layout = final_layout;
+    m_resources.push_back(node);
+    return m_resources.size() - 1;
+  }
+
+  // initial_stages are the stages of earlier work (e.g. the previous frame)
+  // that must finish before the first write to the buffer
+  Resource importBuffer(
+      const std::string& name, vk::DeviceSize size,
+      vk::PipelineStageFlags initial_stages) {
+    ResourceNode node = {};
+    node.name = name;
+    node.imported = true;
+    node.buffer_size = size;
+    node.initial_stages = initial_stages;
+    m_resources.push_back(node);
+    return m_resources.size() - 1;
+  }
+
+  // transient image, owned by the graph and only valid during execute()
+  Resource createImage(const std::string& name, const RGImageDesc& desc) {
+    ResourceNode node = {};
+    node.name = name;
+    node.is_image = true;
+    node.desc = desc;
+    m_resources.push_back(node);
+    return m_resources.size() - 1;
+  }
+
+  void markOutput(Resource res) {
+    m_resources[res].output = true;
+  }
+
+  PassBuilder addPass(const std::string& name, PassFn fn) {
+    PassNode pass = {};
+    pass.name = name;
+    pass.fn = std::move(fn);
+    m_passes.push_back(std::move(pass));
+    return PassBuilder(*this, m_passes.size() - 1);
+  }
+
+  // Memory left over from before the last reset() is reused when it is big
+  // enough, otherwise it is handed to garbage.
+  void compile(
+      vk::Device device, const vk::PhysicalDeviceMemoryProperties& mem_props,
+      Garbage& garbage) {
+    cullPasses();
+    computeLifetimes();
+    allocateTransients(device, mem_props, garbage);
+    computeBarriers();
+
+    size_t n_culled = std::count_if(
+        m_passes.begin(), m_passes.end(), [](const PassNode& p) { return !p.live; });
+    vk::DeviceSize heap_bytes = 0;
+    for (const auto& heap : m_heaps) {
+      heap_bytes += heap.size;
+    }
+    std::cout << "Render graph: " << m_passes.size() << " passes ("
+              << n_culled << " culled), transient memory " << heap_bytes
+              << " bytes (" << m_unaliased_bytes << " without aliasing)\n";
+  }
+
+  void bindImage(Resource res, vk::Image image, vk::ImageView view) {
+    m_resources[res].image = image;
+    m_resources[res].view = view;
+  }
+
+  void bindBuffer(Resource res, vk::Buffer buffer) {
+    m_resources[res].buffer = buffer;
+  }
+
+  vk::Image getImage(Resource res) const {
+    return m_resources[res].image;
+  }
+
+  vk::ImageView getImageView(Resource res) const {
+    return m_resources[res].view;
+  }
+
+  void execute(vk::CommandBuffer& cmd_buf) {
+    for (auto& pass : m_passes) {
+      if (!pass.live) {
+        continue;
+      }
+      emitBarriers(cmd_buf, pass.before);
+      pass.fn(cmd_buf);
+    }
+    emitBarriers(cmd_buf, m_final);
+  }
+
+  // Forget all declarations. Transient images go to garbage, while their
+  // memory is kept for the next compile().
+  void reset(Garbage& garbage) {
+    for (auto& res : m_resources) {
+      if (res.imported || res.image == vk::Image()) {
+        continue;
+      }
+      garbage.views.push_back(res.view);
+      garbage.images.push_back(res.image);
+    }
+    m_spare_heaps.insert(m_spare_heaps.end(), m_heaps.begin(), m_heaps.end());
+    m_resources.clear();
+    m_passes.clear();
+    m_heaps.clear();
+    m_final = {};
+    m_unaliased_bytes = 0;
+  }
+
+  static void destroyGarbage(vk::Device device, Garbage& garbage) {
+    for (auto view : garbage.views) {
+      device.destroyImageView(view, nullptr);
+    }
+    for (auto image : garbage.images) {
+      device.destroyImage(image, nullptr);
+    }
+    for (auto mem : garbage.memory) {
+      device.freeMemory(mem, nullptr);
+    }
+    garbage = {};
+  }
+
+  void destroy(vk::Device device) {
+    Garbage garbage;
+    reset(garbage);
+    for (auto& heap : m_spare_heaps) {
+      garbage.memory.push_back(heap.mem);
+    }
+    m_spare_heaps.clear();
+    destroyGarbage(device, garbage);
+  }
+
+ private:
+  struct ResourceNode {
+    std::string name;
+    bool is_image = false;
+    bool imported = false;
+    bool output = false;
+    RGImageDesc desc = {};
+    vk::DeviceSize buffer_size = 0;
+    vk::ImageLayout initial_layout = vk::ImageLayout::eUndefined;
+    vk::PipelineStageFlags initial_stages = {};
+    vk::ImageLayout final_layout = vk::ImageLayout::eUndefined;
+    // bound handles
+    vk::Image image = {};
+    vk::ImageView view = {};
+    vk::Buffer buffer = {};
+    // transient allocation
+    int first_pass = -1;
+    int last_pass = -1;
+    vk::ImageUsageFlags usage = {};
+    vk::MemoryRequirements mem_reqs = {};
+    uint32_t heap = 0;
+    vk::DeviceSize offset = 0;
+  };
+
+  struct Access {
+    Resource res;
+    RGUsage usage;
+  };
+
+  struct Barrier {
+    Resource res;
+    vk::AccessFlags src_access;
+    vk::AccessFlags dst_access;
+    vk::ImageLayout old_layout;
+    vk::ImageLayout new_layout;
+  };
+
+  struct BarrierBatch {
+    vk::PipelineStageFlags src_stages;
+    vk::PipelineStageFlags dst_stages;
+    std::vector<Barrier> barriers;
+  };
+
+  struct PassNode {
+    std::string name;
+    PassFn fn;
+    std::vector<Access> accesses;
+    bool side_effect = false;
+    bool live = false;
+    BarrierBatch before;
+  };
+
+  struct Heap {
+    uint32_t type_index;
+    vk::DeviceMemory mem;
+    // bytes needed by this compile vs. bytes actually allocated
+    vk::DeviceSize size;
+    vk::DeviceSize capacity;
+    // everything done to any resource in this heap, so that the first use
+    // of an aliased resource waits on the previous tenant (and previous frame)
+    vk::PipelineStageFlags stages;
+    vk::AccessFlags write_access;
+  };
+
+  // Synchronization state of one resource while walking the passes in order.
+  struct State {
+    vk::PipelineStageFlags write_stages;
+    vk::AccessFlags write_access;
+    vk::PipelineStageFlags read_stages;
+    // stages the last write has already been made visible to
+    vk::PipelineStageFlags visible_stages;
+    vk::ImageLayout layout;
+  };
+
+  void cullPasses() {
+    std::vector<bool> needed(m_resources.size());
+    for (size_t i = 0; i < m_resources.size(); ++i) {
+      needed[i] = m_resources[i].output;
+    }
+    // walk backwards: a pass is live if it writes something a live pass
+    // (or the outside world) consumes
+    for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass) {
+      pass->live = pass->side_effect;
+      for (const auto& acc : pass->accesses) {
+        if (getUsageInfo(acc.usage).write && needed[acc.res]) {
+          pass->live = true;
+        }
+      }
+      if (!pass->live) {
+        continue;
+      }
+      for (const auto& acc : pass->accesses) {
+        if (!getUsageInfo(acc.usage).write) {
+          needed[acc.res] = true;
+        }
+      }
+    }
+  }
+
+  void computeLifetimes() {
+    for (int i = 0; i < (int)m_passes.size(); ++i) {
+      if (!m_passes[i].live) {
+        continue;
+      }
+      for (const auto& acc : m_passes[i].accesses) {
+        auto& res = m_resources[acc.res];
+        if (res.first_pass < 0) {
+          res.first_pass = i;
+        }
+        res.last_pass = i;
+        res.usage |= getUsageInfo(acc.usage).image_usage;
+      }
+    }
+  }
+
+  static bool lifetimesOverlap(const ResourceNode& a, const ResourceNode& b) {
+    return a.first_pass <= b.last_pass && b.first_pass <= a.last_pass;
+  }
+
+  void allocateTransients(
+      vk::Device device, const vk::PhysicalDeviceMemoryProperties& mem_props,
+      Garbage& garbage) {
+    std::vector<Resource> transients;
+    for (Resource i = 0; i < m_resources.size(); ++i) {
+      auto& res = m_resources[i];
+      if (res.imported || !res.is_image || res.first_pass < 0) {
+        continue;
+      }
+      vk::ImageCreateInfo info = {};
+      info.sType = vk::StructureType::eImageCreateInfo;
+      info.imageType = vk::ImageType::e2D;
+      info.extent.width = res.desc.extent.width;
+      info.extent.height = res.desc.extent.height;
+      info.extent.depth = 1;
+      info.mipLevels = 1;
+      info.arrayLayers = res.desc.layers;
+      info.format = res.desc.format;
+      info.tiling = vk::ImageTiling::eOptimal;
+      info.initialLayout = vk::ImageLayout::eUndefined;
+      info.usage = res.usage;
+      info.samples = vk::SampleCountFlagBits::e1;
+      info.sharingMode = vk::SharingMode::eExclusive;
+      auto vk_res = device.createImage(&info, nullptr, &res.image);
+      check(vk_res, "createImage");
+      device.getImageMemoryRequirements(res.image, &res.mem_reqs);
+      m_unaliased_bytes += res.mem_reqs.size;
+      transients.push_back(i);
+    }
+
+    // biggest first, each placed at the lowest offset that does not collide
+    // with a resource whose lifetime overlaps
+    std::sort(transients.begin(), transients.end(), [&](Resource a, Resource b) {
+      return m_resources[a].mem_reqs.size > m_resources[b].mem_reqs.size;
+    });
+    std::vector<std::vector<Resource>> placed;
+    for (Resource i : transients) {
+      auto& res = m_resources[i];
+      uint32_t type_index = findMemoryType(
+          mem_props, res.mem_reqs.memoryTypeBits,
+          vk::MemoryPropertyFlagBits::eDeviceLocal);
+      auto heap = std::find_if(m_heaps.begin(), m_heaps.end(), [&](const Heap& h) {
+        return h.type_index == type_index;
+      });
+      if (heap == m_heaps.end()) {
+        m_heaps.push_back({type_index, vk::DeviceMemory(), 0, 0, {}, {}});
+        placed.emplace_back();
+        heap = m_heaps.end() - 1;
+      }
+      res.heap = heap - m_heaps.begin();
+      auto& tenants = placed[res.heap];
+
+      std::vector<vk::DeviceSize> candidates = {0};
+      for (Resource j : tenants) {
+        if (lifetimesOverlap(res, m_resources[j])) {
+          candidates.push_back(m_resources[j].offset + m_resources[j].mem_reqs.size);
+        }
+      }
+      std::sort(candidates.begin(), candidates.end());
+      for (vk::DeviceSize candidate : candidates) {
+        vk::DeviceSize offset = alignUp(candidate, res.mem_reqs.alignment);
+        bool collides = std::any_of(tenants.begin(), tenants.end(), [&](Resource j) {
+          const auto& other = m_resources[j];
+          return lifetimesOverlap(res, other)
+              && offset < other.offset + other.mem_reqs.size
+              && other.offset < offset + res.mem_reqs.size;
+        });
+        if (!collides) {
+          res.offset = offset;
+          break;
+        }
+      }
+      tenants.push_back(i);
+      heap->size = std::max(heap->size, res.offset + res.mem_reqs.size);
+    }
+
+    for (auto& heap : m_heaps) {
+      // e.g. after a resize to a smaller extent, the old memory still fits
+      auto spare = std::find_if(
+          m_spare_heaps.begin(), m_spare_heaps.end(), [&](const Heap& h) {
+            return h.type_index == heap.type_index && h.capacity >= heap.size;
+          });
+      if (spare != m_spare_heaps.end()) {
+        heap.mem = spare->mem;
+        heap.capacity = spare->capacity;
+        m_spare_heaps.erase(spare);
+        continue;
+      }
+      vk::MemoryAllocateInfo info = {};
+      info.sType = vk::StructureType::eMemoryAllocateInfo;
+      info.allocationSize = heap.size;
+      info.memoryTypeIndex = heap.type_index;
+      auto vk_res = device.allocateMemory(&info, nullptr, &heap.mem);
+      check(vk_res, "allocateMemory");
+      heap.capacity = heap.size;
+    }
+    for (auto& spare : m_spare_heaps) {
+      garbage.memory.push_back(spare.mem);
+    }
+    m_spare_heaps.clear();
+
+    for (Resource i : transients) {
+      auto& res = m_resources[i];
+      device.bindImageMemory(res.image, m_heaps[res.heap].mem, res.offset);
+      res.view = createView(device, res);
+    }
+
+    for (const auto& pass : m_passes) {
+      if (!pass.live) {
+        continue;
+      }
+      for (const auto& acc : pass.accesses) {
+        const auto& res = m_resources[acc.res];
+        if (res.imported || !res.is_image) {
+          continue;
+        }
+        auto info = getUsageInfo(acc.usage);
+        m_heaps[res.heap].stages |= info.stages;
+        if (info.write) {
+          m_heaps[res.heap].write_access |= info.access;
+        }
+      }
+    }
+  }
+
+  static vk::ImageView createView(vk::Device device, const ResourceNode& res) {
+    vk::ImageViewCreateInfo info = {};
+    info.sType = vk::StructureType::eImageViewCreateInfo;
+    info.image = res.image;
+    info.viewType = res.desc.layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+    info.format = res.desc.format;
+    info.subresourceRange.aspectMask = res.desc.aspect;
+    info.subresourceRange.baseMipLevel = 0;
+    info.subresourceRange.levelCount = 1;
+    info.subresourceRange.baseArrayLayer = 0;
+    info.subresourceRange.layerCount = res.desc.layers;
+    vk::ImageView view;
+    auto vk_res = device.createImageView(&info, nullptr, &view);
+    check(vk_res, "createImageView");
+    return view;
+  }
+
+  void computeBarriers() {
+    std::vector<State> states(m_resources.size());
+    for (size_t i = 0; i < m_resources.size(); ++i) {
+      const auto& res = m_resources[i];
+      auto& state = states[i];
+      if (res.imported) {
+        // only an execution dependency on whatever came before the graph
+        state.read_stages = res.initial_stages;
+        state.layout = res.initial_layout;
+      }
+      else if (res.first_pass >= 0) {
+        state.write_stages = m_heaps[res.heap].stages;
+        state.write_access = m_heaps[res.heap].write_access;
+        state.layout = vk::ImageLayout::eUndefined;
+      }
+    }
+
+    for (auto& pass : m_passes) {
+      pass.before = {};
+      if (!pass.live) {
+        continue;
+      }
+      for (const auto& acc : pass.accesses) {
+        auto info = getUsageInfo(acc.usage);
+        auto& state = states[acc.res];
+        bool is_image = m_resources[acc.res].is_image;
+        Barrier barrier = {acc.res, {}, info.access, state.layout, info.layout};
+        vk::PipelineStageFlags src_stages = {};
+        if (is_image && state.layout != info.layout) {
+          // layout transitions are writes: wait for readers and writers
+          src_stages = state.write_stages | state.read_stages;
+          barrier.src_access = state.write_access;
+        }
+        else if (info.write) {
+          // WAW or WAR; nothing to do if the resource is untouched
+          src_stages = state.write_stages | state.read_stages;
+          barrier.src_access = state.write_access;
+          if (!src_stages) {
+            updateState(state, info);
+            continue;
+          }
+        }
+        else if (state.write_stages
+                 && (state.visible_stages & info.stages) != info.stages) {
+          // RAW, not yet visible to this stage
+          src_stages = state.write_stages;
+          barrier.src_access = state.write_access;
+        }
+        else {
+          // read after read in the same layout needs no barrier
+          state.read_stages |= info.stages;
+          continue;
+        }
+        pass.before.src_stages |= src_stages;
+        pass.before.dst_stages |= info.stages;
+        pass.before.barriers.push_back(barrier);
+        updateState(state, info);
+      }
+    }
+
+    m_final = {};
+    for (Resource i = 0; i < m_resources.size(); ++i) {
+      const auto& res = m_resources[i];
+      const auto& state = states[i];
+      if (!res.imported || !res.is_image
+          || res.final_layout == vk::ImageLayout::eUndefined
+          || res.final_layout == state.layout) {
+        continue;
+      }
+      m_final.src_stages |= state.write_stages | state.read_stages;
+      m_final.dst_stages |= vk::PipelineStageFlagBits::eBottomOfPipe;
+      m_final.barriers.push_back(
+          {i, state.write_access, {}, state.layout, res.final_layout});
+    }
+  }
+
+  static void updateState(State& state, const RGUsageInfo& info) {
+    state.layout = info.layout;
+    if (info.write) {
+      state.write_stages = info.stages;
+      state.write_access = info.access;
+      state.read_stages = {};
+      state.visible_stages = {};
+    }
+    else {
+      state.read_stages |= info.stages;
+      state.visible_stages |= info.stages;
+    }
+  }
+
+  void emitBarriers(vk::CommandBuffer& cmd_buf, const BarrierBatch& batch) {
+    if (batch.barriers.empty()) {
+      return;
+    }
+    m_image_barriers.clear();
+    m_buffer_barriers.clear();
+    for (const auto& barrier : batch.barriers) {
+      const auto& res = m_resources[barrier.res];
+      if (res.is_image) {
+        vk::ImageMemoryBarrier b = {};
+        b.sType = vk::StructureType::eImageMemoryBarrier;
+        b.srcAccessMask = barrier.src_access;
+        b.dstAccessMask = barrier.dst_access;
+        b.oldLayout = barrier.old_layout;
+        b.newLayout = barrier.new_layout;
+        b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.image = res.image;
+        b.subresourceRange.aspectMask = res.desc.aspect;
+        b.subresourceRange.baseMipLevel = 0;
+        b.subresourceRange.levelCount = 1;
+        b.subresourceRange.baseArrayLayer = 0;
+        b.subresourceRange.layerCount = res.desc.layers;
+        m_image_barriers.push_back(b);
+      }
+      else {
+        vk::BufferMemoryBarrier b = {};
+        b.sType = vk::StructureType::eBufferMemoryBarrier;
+        b.srcAccessMask = barrier.src_access;
+        b.dstAccessMask = barrier.dst_access;
+        b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        b.buffer = res.buffer;
+        b.offset = 0;
+        b.size = VK_WHOLE_SIZE;
+        m_buffer_barriers.push_back(b);
+      }
+    }
+    vk::PipelineStageFlags src_stages = batch.src_stages;
+    if (!src_stages) {
+      src_stages = vk::PipelineStageFlagBits::eTopOfPipe;
+    }
+    cmd_buf.pipelineBarrier(
+        src_stages, batch.dst_stages, {},
+        0, nullptr,
+        m_buffer_barriers.size(), m_buffer_barriers.data(),
+        m_image_barriers.size(), m_image_barriers.data());
+  }
+
+  std::vector<ResourceNode> m_resources;
+  std::vector<PassNode> m_passes;
+  std::vector<Heap> m_heaps;
+  std::vector<Heap> m_spare_heaps;
+  BarrierBatch m_final;
+  vk::DeviceSize m_unaliased_bytes = 0;
+  // scratch space reused across frames
+  std::vector<vk::ImageMemoryBarrier> m_image_barriers;
+  std::vector<vk::BufferMemoryBarrier> m_buffer_barriers;
+};
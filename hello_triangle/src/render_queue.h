@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Each draw is summarized by a 64-bit key so that sorting the keys groups
+// draws by the state they need, most expensive state change first:
+//
+//   63      56 55           36 35         20 19            0
+//   | pipeline |   geometry    |  material  |  depth bucket  |
+//
+// The pipeline always comes first, so draws are split into pipeline
+// groups; layouts for the remaining bits differ by kind of draw (see
+// encodeOpaque and encodeTransparent).
+namespace draw_key {
+
+constexpr int DEPTH_BITS = 20;
+constexpr int MATERIAL_BITS = 16;
+constexpr int GEOMETRY_BITS = 20;
+constexpr int PIPELINE_BITS = 8;
+
+constexpr int DEPTH_SHIFT = 0;
+constexpr int MATERIAL_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+constexpr int GEOMETRY_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+constexpr int PIPELINE_SHIFT = GEOMETRY_SHIFT + GEOMETRY_BITS;
+static_assert(PIPELINE_SHIFT + PIPELINE_BITS == 64);
+
+constexpr uint64_t mask(int bits) {
+  return (uint64_t(1) << bits) - 1;
+}
+
+constexpr uint64_t encode(
+    uint32_t pipeline, uint32_t geometry, uint32_t material, uint32_t depth) {
+  return ((pipeline & mask(PIPELINE_BITS)) << PIPELINE_SHIFT)
+      | ((geometry & mask(GEOMETRY_BITS)) << GEOMETRY_SHIFT)
+      | ((material & mask(MATERIAL_BITS)) << MATERIAL_SHIFT)
+      | ((depth & mask(DEPTH_BITS)) << DEPTH_SHIFT);
+}
+
+constexpr uint32_t pipeline(uint64_t key) {
+  return (key >> PIPELINE_SHIFT) & mask(PIPELINE_BITS);
+}
+
+// Opaque draws go roughly front-to-back so early depth testing rejects
+// hidden fragments, but state changes only within coarse depth slabs:
+//
+//   63      56 55  52 51       36 35         20 19            0
+//   | pipeline | slab | geometry |  material  |  depth bucket  |
+//
+constexpr int SLAB_BITS = 4;
+constexpr int OPAQUE_GEOMETRY_BITS = GEOMETRY_BITS - SLAB_BITS;
+constexpr int SLAB_SHIFT = GEOMETRY_SHIFT + OPAQUE_GEOMETRY_BITS;
+
+constexpr uint64_t encodeOpaque(
+    uint32_t pipeline, uint32_t geometry, uint32_t material, uint32_t depth) {
+  uint64_t slab = (depth & mask(DEPTH_BITS)) >> (DEPTH_BITS - SLAB_BITS);
+  return ((pipeline & mask(PIPELINE_BITS)) << PIPELINE_SHIFT)
+      | (slab << SLAB_SHIFT)
+      | ((geometry & mask(OPAQUE_GEOMETRY_BITS)) << GEOMETRY_SHIFT)
+      | ((material & mask(MATERIAL_BITS)) << MATERIAL_SHIFT)
+      | ((depth & mask(DEPTH_BITS)) << DEPTH_SHIFT);
+}
+
+// Blended draws must go strictly back-to-front, so the inverted depth comes
+// before any state:
+//
+//   63      56 55           36 35         20 19            0
+//   | pipeline | ~depth bucket |  geometry  |    material    |
+//
+constexpr uint64_t encodeTransparent(
+    uint32_t pipeline, uint32_t geometry, uint32_t material, uint32_t depth) {
+  uint64_t far_first = mask(DEPTH_BITS) - (depth & mask(DEPTH_BITS));
+  return ((pipeline & mask(PIPELINE_BITS)) << PIPELINE_SHIFT)
+      | (far_first << (PIPELINE_SHIFT - DEPTH_BITS))
+      | ((geometry & mask(GEOMETRY_BITS)) << MATERIAL_BITS)
+      | (material & mask(MATERIAL_BITS));
+}
+
+// quantize view distance in [near, far] into a depth bucket
+inline uint32_t depthBucket(float dist, float near, float far) {
+  float t = std::clamp((dist - near) / (far - near), 0.0f, 1.0f);
+  return static_cast<uint32_t>(t * mask(DEPTH_BITS));
+}
+
+} // namespace draw_key
+
+struct DrawItem {
+  uint64_t key;
+  // index of the object to draw
+  uint32_t index;
+};
+
+// Per-frame list of draws, sorted by key before submission. Storage is kept
+// between frames so steady-state use does not allocate.
+class RenderQueue {
+ public:
+  void clear() {
+    m_items.clear();
+  }
+
+  void push(uint64_t key, uint32_t index) {
+    m_items.push_back({key, index});
+  }
+
+  // LSD radix sort on bytes; passes where every key has the same byte
+  // (typically the unused high bits of each field) are skipped
+  void sort() {
+    m_scratch.resize(m_items.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+      std::array<uint32_t, 256> counts = {};
+      for (const auto& item : m_items) {
+        counts[(item.key >> shift) & 0xff]++;
+      }
+      if (m_items.empty() || counts[(m_items[0].key >> shift) & 0xff] == m_items.size()) {
+        continue;
+      }
+      uint32_t offset = 0;
+      for (auto& count : counts) {
+        uint32_t n = count;
+        count = offset;
+        offset += n;
+      }
+      for (const auto& item : m_items) {
+        m_scratch[counts[(item.key >> shift) & 0xff]++] = item;
+      }
+      std::swap(m_items, m_scratch);
+    }
+  }
+
+  const std::vector<DrawItem>& items() const {
+    return m_items;
+  }
+
+ private:
+  std::vector<DrawItem> m_items;
+  std::vector<DrawItem> m_scratch;
+};
+
+// Bind and draw counts for one frame, including binds skipped because the
+// state was already bound.
+struct DrawStats {
+  uint32_t draws = 0;
+  uint32_t pipeline_binds = 0;
+  uint32_t pipeline_binds_elided = 0;
+  uint32_t geometry_binds = 0;
+  uint32_t geometry_binds_elided = 0;
+  uint32_t triangles = 0;
+  uint32_t push_constant_bytes = 0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Fraction of the output resolution the scene is rendered at, steered so
+// the GPU time of a frame stays within a budget. Pixel cost goes with area,
+// so the scale moves with the square root of budget over measured time.
+// Measurements are smoothed and small corrections skipped so the
+// resolution does not flicker.
+class RenderScale {
+ public:
+  // weight of the newest measurement in the running average
+  static constexpr double SMOOTHING = 0.1;
+  // aim below the budget so noise does not push frames over it
+  static constexpr double HEADROOM = 0.9;
+  // scale changes smaller than this are not worth re-rendering for
+  static constexpr float DEADBAND = 0.05f;
+
+  RenderScale() = default;
+  RenderScale(double budget_ms, float min_scale)
+      : m_budget_ms(budget_ms), m_min_scale(min_scale) {}
+
+  // feed the GPU time of one frame at the current scale; true if the scale
+  // changed
+  bool update(double gpu_ms) {
+    if (m_budget_ms <= 0.0 || gpu_ms <= 0.0) {
+      return false;
+    }
+    m_avg_ms = m_avg_ms == 0.0 ? gpu_ms : m_avg_ms + (gpu_ms - m_avg_ms) * SMOOTHING;
+    float target = m_scale * std::sqrt(m_budget_ms * HEADROOM / m_avg_ms);
+    target = std::clamp(target, m_min_scale, 1.0f);
+    if (std::abs(target - m_scale) < DEADBAND && target != 1.0f && target != m_min_scale) {
+      return false;
+    }
+    if (target == m_scale) {
+      return false;
+    }
+    // expected time at the new scale, until measurements catch up
+    m_avg_ms *= (target / m_scale) * (target / m_scale);
+    m_scale = target;
+    return true;
+  }
+
+  float scale() const {
+    return m_scale;
+  }
+
+  // smoothed GPU time of recent frames
+  double averageMs() const {
+    return m_avg_ms;
+  }
+
+ private:
+  double m_budget_ms = 0.0;
+  float m_min_scale = 1.0f;
+  float m_scale = 1.0f;
+  double m_avg_ms = 0.0;
+};
@@ -0,0 +1,25 @@
+#include "application.h"
+
+// Replays a capture recorded with --capture, headless and as fast as the
+// device allows, then reports throughput.
+int main(int argc, char** argv) {
+  if (argc < 2 || argv[1][0] == '-') {
+    std::cerr << "usage: " << argv[0] << " <capture> [options]\n";
+    return 1;
+  }
+  try {
+    // whatever follows the capture is parsed as regular options
+    std::string path = argv[1];
+    argv[1] = argv[0];
+    Options options = parseOptions(argc - 1, argv + 1);
+    options.replay = path;
+    options.headless = true;
+    Application app(std::move(options));
+    app.run();
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
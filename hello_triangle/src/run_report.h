@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Per-frame durations of a run, kept whole for percentiles. Space is
+// reserved up front so that adding a sample never touches the heap; samples
+// beyond it are dropped.
+class FrameTimes {
+ public:
+  struct Summary {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+  };
+
+  void reserve(uint64_t frames) {
+    m_samples.reserve(frames);
+  }
+
+  void add(double ms) {
+    if (m_samples.size() < m_samples.capacity()) {
+      m_samples.push_back(ms);
+    }
+  }
+
+  Summary summary() const {
+    Summary s;
+    if (m_samples.empty()) {
+      return s;
+    }
+    std::vector<double> sorted = m_samples;
+    std::sort(sorted.begin(), sorted.end());
+    s.count = sorted.size();
+    for (double ms : sorted) {
+      s.mean += ms;
+    }
+    s.mean /= sorted.size();
+    s.p50 = percentile(sorted, 0.50);
+    s.p95 = percentile(sorted, 0.95);
+    s.max = sorted.back();
+    return s;
+  }
+
+ private:
+  // nearest rank
+  static double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)(p * sorted.size());
+    return sorted[std::min(rank, sorted.size() - 1)];
+  }
+
+  std::vector<double> m_samples;
+};
+
+// What a run with a fixed frame count measured, for the benchmark
+struct RunReport {
+  uint64_t frames = 0;
+  double seconds = 0.0;
+  uint32_t meshes = 0;
+  uint32_t geometries = 0;
+  // vertex and index buffers after deduplication
+  uint32_t streams = 0;
+  // of the last frame
+  uint64_t draws = 0;
+  uint64_t triangles = 0;
+  // wall time of each render loop iteration, CPU work plus any wait on the
+  // GPU or swapchain
+  FrameTimes cpu_ms;
+  // between timestamps bracketing each frame's commands; empty without
+  // timestamp support
+  FrameTimes gpu_ms;
+  // most device memory in use at the end of any frame, see
+  // Application::deviceMemoryInUse
+  uint64_t peak_device_bytes = 0;
+  // made by the frames themselves, past startup
+  uint64_t heap_allocations = 0;
+};
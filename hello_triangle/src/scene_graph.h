@@ -0,0 +1,169 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "job_system.h"
+#include "transform_kernel.h"
+
+// contiguous run of nodes [first, first + count)
+struct NodeRange {
+  uint32_t first;
+  uint32_t count;
+};
+
+// Hierarchical transforms in flat arrays. Nodes can only be parented to
+// existing nodes, so storage order is a topological order and a single
+// forward sweep propagates world matrices. Only nodes whose local TRS was
+// touched, and their descendants, are recomputed. Local TRS is stored one
+// array per component so local matrices are composed with SIMD kernels.
+class SceneGraph {
+ public:
+  using Node = uint32_t;
+  static constexpr Node NO_PARENT = ~0u;
+
+  Node addNode(Node parent = NO_PARENT) {
+    m_parent.push_back(parent);
+    for (auto* component : {&m_tx, &m_ty, &m_tz, &m_qx, &m_qy, &m_qz}) {
+      component->push_back(0.0f);
+    }
+    for (auto* component : {&m_qw, &m_sx, &m_sy, &m_sz}) {
+      component->push_back(1.0f);
+    }
+    m_local.push_back(glm::mat4(1.0f));
+    m_world.push_back(glm::mat4(1.0f));
+    m_dirty.push_back(true);
+    m_changed.push_back(false);
+    return m_parent.size() - 1;
+  }
+
+  void setTranslation(Node node, const glm::vec3& trans) {
+    m_tx[node] = trans.x;
+    m_ty[node] = trans.y;
+    m_tz[node] = trans.z;
+    m_dirty[node] = true;
+  }
+  void setRotation(Node node, const glm::quat& rot) {
+    m_qx[node] = rot.x;
+    m_qy[node] = rot.y;
+    m_qz[node] = rot.z;
+    m_qw[node] = rot.w;
+    m_dirty[node] = true;
+  }
+  void setScale(Node node, const glm::vec3& scale) {
+    m_sx[node] = scale.x;
+    m_sy[node] = scale.y;
+    m_sz[node] = scale.z;
+    m_dirty[node] = true;
+  }
+
+  Node parent(Node node) const {
+    return m_parent[node];
+  }
+  glm::vec3 translation(Node node) const {
+    return glm::vec3(m_tx[node], m_ty[node], m_tz[node]);
+  }
+  glm::quat rotation(Node node) const {
+    return glm::quat(m_qw[node], m_qx[node], m_qy[node], m_qz[node]);
+  }
+  glm::vec3 scale(Node node) const {
+    return glm::vec3(m_sx[node], m_sy[node], m_sz[node]);
+  }
+  const glm::mat4& world(Node node) const {
+    return m_world[node];
+  }
+  const glm::mat4* worldData() const {
+    return m_world.data();
+  }
+  size_t size() const {
+    return m_parent.size();
+  }
+
+  // jobs, if given, composes long runs of dirty nodes in parallel
+  void update(JobSystem* jobs = nullptr) {
+    composeDirtyLocals(jobs);
+    m_changed_ranges.clear();
+    for (Node i = 0; i < m_parent.size(); ++i) {
+      Node parent = m_parent[i];
+      bool parent_changed = parent != NO_PARENT && m_changed[parent];
+      m_changed[i] = m_dirty[i] || parent_changed;
+      m_dirty[i] = false;
+      if (!m_changed[i]) {
+        continue;
+      }
+      m_world[i] = parent == NO_PARENT ? m_local[i] : m_world[parent] * m_local[i];
+      if (!m_changed_ranges.empty()
+          && m_changed_ranges.back().first + m_changed_ranges.back().count == i) {
+        m_changed_ranges.back().count++;
+      }
+      else {
+        m_changed_ranges.push_back({i, 1});
+      }
+    }
+  }
+
+  // overwrite world matrices computed elsewhere (e.g. replayed from a
+  // capture); local TRS is left alone
+  void setWorld(NodeRange range, const glm::mat4* world) {
+    std::copy(world, world + range.count, m_world.begin() + range.first);
+  }
+
+  // nodes whose world matrix changed in the last update()
+  const std::vector<NodeRange>& changedRanges() const {
+    return m_changed_ranges;
+  }
+
+ private:
+  // nodes per compose job; smaller runs are not worth the scheduling
+  static constexpr uint32_t COMPOSE_GRAIN = 1024;
+
+  // compose T * R * S for each run of consecutive dirty nodes
+  void composeDirtyLocals(JobSystem* jobs) {
+    TRSArrays trs = {
+      m_tx.data(), m_ty.data(), m_tz.data(),
+      m_qx.data(), m_qy.data(), m_qz.data(), m_qw.data(),
+      m_sx.data(), m_sy.data(), m_sz.data(),
+    };
+    size_t n = m_parent.size();
+    size_t i = 0;
+    while (i < n) {
+      if (!m_dirty[i]) {
+        ++i;
+        continue;
+      }
+      size_t end = i + 1;
+      while (end < n && m_dirty[end]) {
+        ++end;
+      }
+      if (jobs) {
+        jobs->parallelFor(end - i, COMPOSE_GRAIN, [&](uint32_t begin, uint32_t stop) {
+          m_compose(trs, i + begin, i + stop, glm::value_ptr(m_local[i + begin]));
+        });
+      }
+      else {
+        m_compose(trs, i, end, glm::value_ptr(m_local[i]));
+      }
+      i = end;
+    }
+  }
+
+  ComposeTRSFn m_compose = selectComposeTRS();
+  std::vector<Node> m_parent;
+  // local TRS, one array per component
+  std::vector<float> m_tx, m_ty, m_tz;
+  std::vector<float> m_qx, m_qy, m_qz, m_qw;
+  std::vector<float> m_sx, m_sy, m_sz;
+  std::vector<glm::mat4> m_local;
+  std::vector<glm::mat4> m_world;
+  // local TRS modified since the last update
+  std::vector<uint8_t> m_dirty;
+  // world matrix recomputed in the last update
+  std::vector<uint8_t> m_changed;
+  std::vector<NodeRange> m_changed_ranges;
+};
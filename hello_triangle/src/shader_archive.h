@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compiled shader variants packed by shaders/pack.cpp and linked into the
+// binary as one blob. Layout, little endian:
+//   u32 magic, u32 count
+//   count x {u32 key_offset, u32 key_size, u32 code_offset, u32 code_size},
+//     sorted by key
+//   keys and SPIR-V, code 4-byte aligned
+// Offsets are from the start of the archive.
+namespace shader_archive {
+
+constexpr uint32_t MAGIC = 0x4b415053; // "SPAK"
+
+struct Entry {
+  uint32_t key_offset;
+  uint32_t key_size;
+  uint32_t code_offset;
+  uint32_t code_size;
+};
+
+}
+
+// Key of a shader compiled with these defines, e.g. "shader.vert+MULTIVIEW";
+// matches the keys add_shader gives in shaders/CMakeLists.txt.
+inline std::string shaderVariant(
+    std::string_view source, std::initializer_list<std::string_view> defines = {}) {
+  std::string key(source);
+  for (auto define : defines) {
+    key += '+';
+    key += define;
+  }
+  return key;
+}
+
+class ShaderArchive {
+ public:
+  ShaderArchive(const uint8_t* begin, const uint8_t* end)
+      : m_data(begin), m_size(end - begin) {
+    if (m_size < 2 * sizeof(uint32_t) || read(0) != shader_archive::MAGIC) {
+      throw std::runtime_error("shader archive is corrupt");
+    }
+    m_count = read(sizeof(uint32_t));
+    if (headerSize() > m_size) {
+      throw std::runtime_error("shader archive is corrupt");
+    }
+    for (uint32_t i = 0; i < m_count; ++i) {
+      auto e = entry(i);
+      if (uint64_t(e.key_offset) + e.key_size > m_size
+          || uint64_t(e.code_offset) + e.code_size > m_size) {
+        throw std::runtime_error("shader archive is corrupt");
+      }
+    }
+  }
+
+  uint32_t size() const {
+    return m_count;
+  }
+
+  // a copy of the SPIR-V, aligned for vk::ShaderModuleCreateInfo
+  std::vector<char> code(std::string_view key) const {
+    uint32_t lo = 0;
+    uint32_t hi = m_count;
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) / 2;
+      auto e = entry(mid);
+      std::string_view mid_key(reinterpret_cast<const char*>(m_data) + e.key_offset, e.key_size);
+      if (mid_key == key) {
+        const char* code = reinterpret_cast<const char*>(m_data) + e.code_offset;
+        return std::vector<char>(code, code + e.code_size);
+      }
+      if (mid_key < key) {
+        lo = mid + 1;
+      }
+      else {
+        hi = mid;
+      }
+    }
+    throw std::runtime_error("no shader variant " + std::string(key));
+  }
+
+ private:
+  // the blob is only byte aligned
+  uint32_t read(size_t offset) const {
+    uint32_t value;
+    memcpy(&value, m_data + offset, sizeof(value));
+    return value;
+  }
+
+  shader_archive::Entry entry(uint32_t i) const {
+    shader_archive::Entry e;
+    memcpy(&e, m_data + 2 * sizeof(uint32_t) + i * sizeof(e), sizeof(e));
+    return e;
+  }
+
+  uint64_t headerSize() const {
+    return 2 * sizeof(uint32_t) + uint64_t(m_count) * sizeof(shader_archive::Entry);
+  }
+
+  const uint8_t* m_data;
+  size_t m_size;
+  uint32_t m_count = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// Neither side blocks or allocates: push fails when the queue is full and
+// pop when it is empty.
+template<typename T, uint32_t N>
+class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+ public:
+  // producer only
+  bool push(const T& item) {
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == N) {
+      return false;
+    }
+    m_items[head % N] = item;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only
+  bool pop(T& item) {
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = m_items[tail % N];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::array<T, N> m_items;
+  // free-running counters, kept on separate cache lines
+  alignas(64) std::atomic<uint32_t> m_head = 0;
+  alignas(64) std::atomic<uint32_t> m_tail = 0;
+};
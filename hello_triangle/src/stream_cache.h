@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// Content-addressed store of immutable attribute streams (positions,
+// colors, indices, ...). Streams with identical bytes share one entry, and
+// so one GPU buffer, created on first acquire() and destroyed when the last
+// user release()s it. The bytes are kept to rule out hash collisions.
+template<typename Buffer>
+class StreamCache {
+ public:
+  using Stream = uint32_t;
+
+  // create(data, size) makes the buffer for content not seen before
+  template<typename CreateFn>
+  Stream acquire(const void* data, size_t size, CreateFn&& create) {
+    uint64_t hash = hashBytes(data, size);
+    auto [first, last] = m_by_hash.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+      auto& entry = m_entries[it->second];
+      if (entry.bytes.size() == size && memcmp(entry.bytes.data(), data, size) == 0) {
+        entry.refs++;
+        m_shared_bytes += size;
+        return it->second;
+      }
+    }
+
+    Stream stream;
+    if (!m_free.empty()) {
+      stream = m_free.back();
+      m_free.pop_back();
+    }
+    else {
+      stream = m_entries.size();
+      m_entries.emplace_back();
+    }
+    auto& entry = m_entries[stream];
+    auto bytes = static_cast<const uint8_t*>(data);
+    entry.bytes.assign(bytes, bytes + size);
+    entry.hash = hash;
+    entry.refs = 1;
+    entry.buffer = create(data, size);
+    m_by_hash.emplace(hash, stream);
+    m_unique_bytes += size;
+    m_live++;
+    return stream;
+  }
+
+  // destroy(buffer) is called once the stream has no users left
+  template<typename DestroyFn>
+  void release(Stream stream, DestroyFn&& destroy) {
+    auto& entry = m_entries[stream];
+    if (entry.refs == 0) {
+      throw std::runtime_error("stream released more often than acquired");
+    }
+    if (--entry.refs > 0) {
+      m_shared_bytes -= entry.bytes.size();
+      return;
+    }
+    destroy(entry.buffer);
+    auto [first, last] = m_by_hash.equal_range(entry.hash);
+    for (auto it = first; it != last; ++it) {
+      if (it->second == stream) {
+        m_by_hash.erase(it);
+        break;
+      }
+    }
+    m_unique_bytes -= entry.bytes.size();
+    entry.bytes = {};
+    entry.buffer = {};
+    m_free.push_back(stream);
+    m_live--;
+  }
+
+  const Buffer& buffer(Stream stream) const {
+    return m_entries[stream].buffer;
+  }
+
+  uint32_t refs(Stream stream) const {
+    return m_entries[stream].refs;
+  }
+
+  // streams with at least one user
+  uint32_t size() const {
+    return m_live;
+  }
+
+  // bytes of distinct content held
+  uint64_t uniqueBytes() const {
+    return m_unique_bytes;
+  }
+
+  // bytes that would have been duplicated without sharing
+  uint64_t sharedBytes() const {
+    return m_shared_bytes;
+  }
+
+ private:
+  struct Entry {
+    Buffer buffer = {};
+    uint64_t hash = 0;
+    std::vector<uint8_t> bytes;
+    uint32_t refs = 0;
+  };
+
+  // FNV-1a
+  static uint64_t hashBytes(const void* data, size_t size) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  std::vector<Entry> m_entries;
+  std::unordered_multimap<uint64_t, Stream> m_by_hash;
+  std::vector<Stream> m_free;
+  uint32_t m_live = 0;
+  uint64_t m_unique_bytes = 0;
+  uint64_t m_shared_bytes = 0;
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TRS_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+// Translation / rotation (quaternion) / scale for many transforms, one
+// array per component.
+struct TRSArrays {
+  const float* tx;
+  const float* ty;
+  const float* tz;
+  const float* qx;
+  const float* qy;
+  const float* qz;
+  const float* qw;
+  const float* sx;
+  const float* sy;
+  const float* sz;
+};
+
+// Writes T * R * S for transforms [begin, end) as column-major 4x4 matrices,
+// 16 floats each, to out[0 .. 16 * (end - begin)). out may point straight
+// into mapped GPU memory.
+using ComposeTRSFn = void (*)(const TRSArrays& trs, size_t begin, size_t end, float* out);
+
+inline void composeTRSScalar(const TRSArrays& trs, size_t begin, size_t end, float* out) {
+  for (size_t i = begin; i < end; ++i, out += 16) {
+    float x = trs.qx[i], y = trs.qy[i], z = trs.qz[i], w = trs.qw[i];
+    float sx = trs.sx[i], sy = trs.sy[i], sz = trs.sz[i];
+    // same as glm::mat4_cast, columns scaled
+    out[0] = (1.0f - 2.0f * (y*y + z*z)) * sx;
+    out[1] = 2.0f * (x*y + w*z) * sx;
+    out[2] = 2.0f * (x*z - w*y) * sx;
+    out[3] = 0.0f;
+    out[4] = 2.0f * (x*y - w*z) * sy;
+    out[5] = (1.0f - 2.0f * (x*x + z*z)) * sy;
+    out[6] = 2.0f * (y*z + w*x) * sy;
+    out[7] = 0.0f;
+    out[8] = 2.0f * (x*z + w*y) * sz;
+    out[9] = 2.0f * (y*z - w*x) * sz;
+    out[10] = (1.0f - 2.0f * (x*x + y*y)) * sz;
+    out[11] = 0.0f;
+    out[12] = trs.tx[i];
+    out[13] = trs.ty[i];
+    out[14] = trs.tz[i];
+    out[15] = 1.0f;
+  }
+}
+
+#ifdef TRS_KERNEL_X86
+
+// 4 transforms per iteration; SSE2 is part of the x86-64 baseline
+inline void composeTRSSSE(const TRSArrays& trs, size_t begin, size_t end, float* out) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 zero = _mm_setzero_ps();
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4, out += 64) {
+    __m128 x = _mm_loadu_ps(trs.qx + i);
+    __m128 y = _mm_loadu_ps(trs.qy + i);
+    __m128 z = _mm_loadu_ps(trs.qz + i);
+    __m128 w = _mm_loadu_ps(trs.qw + i);
+    __m128 sx = _mm_loadu_ps(trs.sx + i);
+    __m128 sy = _mm_loadu_ps(trs.sy + i);
+    __m128 sz = _mm_loadu_ps(trs.sz + i);
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+    // columns of the scaled rotation, one transform per lane
+    __m128 cols[4][4] = {
+      {
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+        zero,
+      },
+      {
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+        zero,
+      },
+      {
+        _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+        _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+        zero,
+      },
+      {
+        _mm_loadu_ps(trs.tx + i),
+        _mm_loadu_ps(trs.ty + i),
+        _mm_loadu_ps(trs.tz + i),
+        one,
+      },
+    };
+    // transpose lanes into per-transform columns
+    for (int c = 0; c < 4; ++c) {
+      __m128 t0 = _mm_unpacklo_ps(cols[c][0], cols[c][1]);
+      __m128 t1 = _mm_unpackhi_ps(cols[c][0], cols[c][1]);
+      __m128 t2 = _mm_unpacklo_ps(cols[c][2], cols[c][3]);
+      __m128 t3 = _mm_unpackhi_ps(cols[c][2], cols[c][3]);
+      _mm_storeu_ps(out + 0*16 + c*4, _mm_movelh_ps(t0, t2));
+      _mm_storeu_ps(out + 1*16 + c*4, _mm_movehl_ps(t2, t0));
+      _mm_storeu_ps(out + 2*16 + c*4, _mm_movelh_ps(t1, t3));
+      _mm_storeu_ps(out + 3*16 + c*4, _mm_movehl_ps(t3, t1));
+    }
+  }
+  composeTRSScalar(trs, i, end, out);
+}
+
+// 8 transforms per iteration
+__attribute__((target("avx2")))
+inline void composeTRSAVX2(const TRSArrays& trs, size_t begin, size_t end, float* out) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 zero = _mm256_setzero_ps();
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8, out += 128) {
+    __m256 x = _mm256_loadu_ps(trs.qx + i);
+    __m256 y = _mm256_loadu_ps(trs.qy + i);
+    __m256 z = _mm256_loadu_ps(trs.qz + i);
+    __m256 w = _mm256_loadu_ps(trs.qw + i);
+    __m256 sx = _mm256_loadu_ps(trs.sx + i);
+    __m256 sy = _mm256_loadu_ps(trs.sy + i);
+    __m256 sz = _mm256_loadu_ps(trs.sz + i);
+    __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+    __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+    __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+    __m256 cols[4][4] = {
+      {
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+        zero,
+      },
+      {
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+        zero,
+      },
+      {
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz),
+        zero,
+      },
+      {
+        _mm256_loadu_ps(trs.tx + i),
+        _mm256_loadu_ps(trs.ty + i),
+        _mm256_loadu_ps(trs.tz + i),
+        one,
+      },
+    };
+    // 4x4 transpose within each 128-bit half: the low half holds
+    // transforms 0-3, the high half transforms 4-7
+    for (int c = 0; c < 4; ++c) {
+      __m256 t0 = _mm256_unpacklo_ps(cols[c][0], cols[c][1]);
+      __m256 t1 = _mm256_unpackhi_ps(cols[c][0], cols[c][1]);
+      __m256 t2 = _mm256_unpacklo_ps(cols[c][2], cols[c][3]);
+      __m256 t3 = _mm256_unpackhi_ps(cols[c][2], cols[c][3]);
+      __m256 r[4] = {
+        _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+        _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+      };
+      for (int j = 0; j < 4; ++j) {
+        _mm_storeu_ps(out + j*16 + c*4, _mm256_castps256_ps128(r[j]));
+        _mm_storeu_ps(out + (j + 4)*16 + c*4, _mm256_extractf128_ps(r[j], 1));
+      }
+    }
+  }
+  composeTRSScalar(trs, i, end, out);
+}
+
+#endif // TRS_KERNEL_X86
+
+// widest kernel the running CPU supports
+inline ComposeTRSFn selectComposeTRS() {
+#ifdef TRS_KERNEL_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return composeTRSAVX2;
+  }
+  return composeTRSSSE;
+#else
+  return composeTRSScalar;
+#endif
+}
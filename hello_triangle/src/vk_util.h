@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <stdexcept>
+#include <string>
+
+// kept out of line so check() stays a compare and branch; the message is
+// only turned into a string once something has failed
+[[noreturn, gnu::cold, gnu::noinline]]
+inline void throwVkError(vk::Result res, const char* msg) {
+  throw std::runtime_error(std::string(msg) + " (" + vk::to_string(res) + ")");
+}
+
+inline void check(vk::Result res, const char* msg) {
+  if (res != vk::Result::eSuccess) [[unlikely]] {
+    throwVkError(res, msg);
+  }
+}
+
+inline void check(VkResult res, const char* msg) {
+  check(static_cast<vk::Result>(res), msg);
+}
+
+inline uint32_t findMemoryType(
+    const vk::PhysicalDeviceMemoryProperties& props,
+    uint32_t type_filter, vk::MemoryPropertyFlags flags) {
+  for (uint32_t i = 0; i < props.memoryTypeCount; ++i) {
+    // restrict the allowable types
+    if (!(type_filter & (1 << i))) {
+      continue;
+    }
+    // all required properties are available
+    if ((props.memoryTypes[i].propertyFlags & flags) != flags) {
+      continue;
+    }
+    return i;
+  }
+
+  throw std::runtime_error("failed to find suitable memory");
+}
+
+inline vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}